@@ -0,0 +1,64 @@
+@echo off
+setlocal enabledelayedexpansion
+
+:: Builds the command-line tools in tools\ (headless runner, benchmarks, ...).
+:: Tools link the simulation core only: no GLFW/OpenGL, so they run on machines without a display.
+
+:: Project Configuration
+set SRC_DIR=src\fluid
+set TOOLS_DIR=tools
+set INCLUDE_DIR=include
+set OUTPUT_DIR=bin
+set OBJ_DIR=obj\tools
+
+:: Compiler configuration
+set CXX=g++
+set CXXFLAGS=-std=c++23 -Wall -Wextra -pedantic -Iinclude -O2
+set LDFLAGS=
+
+:: Create output directories
+if not exist "%OUTPUT_DIR%" mkdir "%OUTPUT_DIR%"
+if not exist "%OBJ_DIR%" mkdir "%OBJ_DIR%"
+
+echo [INFO] Building tools with MinGW
+echo.
+
+:: Verify compiler availability
+%CXX% --version >nul 2>&1
+if errorlevel 1 (
+    echo [ERROR] Compiler not found in PATH
+    echo [ERROR] Please ensure MinGW bin directory is in your system PATH
+    exit /b 1
+)
+
+echo [INFO] Step 1: Building simulation core (without render.cpp)...
+set CORE_OBJS=
+for %%i in ("%SRC_DIR%\*.cpp") do (
+    if /i not "%%~ni"=="render" (
+        set OBJ_FILE="%OBJ_DIR%\%%~ni.o"
+        echo [CC] Compiling %%~nxi...
+        "%CXX%" %CXXFLAGS% -c "%%i" -o !OBJ_FILE!
+        if errorlevel 1 (
+            echo [ERROR] Failed to compile %%~nxi
+            goto :BUILD_FAILED
+        )
+        set CORE_OBJS=!CORE_OBJS! !OBJ_FILE!
+    )
+)
+
+echo [INFO] Step 2: Building tools...
+for %%i in ("%TOOLS_DIR%\*.cpp") do (
+    echo [LD] %%~ni.exe
+    "%CXX%" %CXXFLAGS% "%%i" !CORE_OBJS! -o "%OUTPUT_DIR%\%%~ni.exe" %LDFLAGS%
+    if errorlevel 1 (
+        echo [ERROR] Failed to build %%~ni
+        goto :BUILD_FAILED
+    )
+)
+
+echo [INFO] BUILD SUCCESSFUL!
+goto :EOF
+
+:BUILD_FAILED
+echo [ERROR] BUILD FAILED!
+exit /b 1
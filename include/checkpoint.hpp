@@ -0,0 +1,110 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <population_storage.hpp>
+
+template <typename Scalar> class BasicBLWFluid;
+
+// Fixed-size header at the start of a checkpoint file. All values are in host byte
+// order; 'byte_order_mark' lets a reader on another architecture reject the file.
+struct CheckpointHeader {
+    char magic[8];                  // "BLWCKPT" + '\0'
+    uint32_t version;               // CHECKPOINT_VERSION
+    uint32_t byte_order_mark;       // 0x01020304 as written by the saving host
+    int32_t width;                  // Grid cells in X
+    int32_t height;                 // Grid cells in Y
+    int32_t ordering;               // CellOrdering of the population arrays
+    int32_t num_velocities;         // Populations per cell (9 for D2Q9)
+    double cell_size;               // Cell size in world units
+    double viscosity;               // Kinematic viscosity
+    double gravity;                 // Gravity in Y
+    uint32_t scalar_size;           // Bytes per density value (4 = float, 8 = double)
+    uint32_t population_precision;  // PopulationPrecision of the population section (stored as is)
+    int64_t step_count;             // Completed update() calls
+    uint64_t cell_count;            // width * height
+    uint64_t polygon_count;         // Obstacle polygons stored after the mask
+    uint64_t vertex_count;          // Total obstacle vertices
+    uint64_t checksum;              // section_checksum() of this header (checksum = 0) and the section payloads
+};
+
+const uint32_t CHECKPOINT_VERSION = 3;
+
+// In-memory copy of the solver state, in the order it is written to disk. Capturing
+// into a CheckpointState is a plain copy, so the solver can continue while the copy
+// is written out. Populations are kept in their storage format (so 16-bit runs restart
+// bit for bit); density is an array of the solver's scalar type.
+struct CheckpointState {
+    CheckpointHeader header;
+    std::vector<uint8_t> populations;     // [storage_idx * num_velocities + i]
+    std::vector<uint8_t> density;         // [storage_idx]
+    std::vector<uint8_t> obstacle;        // [storage_idx], 1 = obstacle cell
+    std::vector<uint32_t> polygon_sizes;  // Vertices per obstacle polygon
+    std::vector<float> vertices;          // x, y per obstacle vertex (all polygons back to back)
+};
+
+// Byte offsets of the sections in a checkpoint file (each aligned to 64 bytes so a
+// memory-mapped file can be read as float arrays in place)
+struct CheckpointSections {
+    uint64_t populations;
+    uint64_t density;
+    uint64_t obstacle;
+    uint64_t polygon_sizes;
+    uint64_t vertices;
+    uint64_t file_size;
+};
+
+CheckpointSections checkpoint_sections(const CheckpointHeader& header);
+
+// Write 'state' to 'filename' (via a temporary file renamed on success, so an interrupted
+// write never replaces the previous checkpoint). Returns false on I/O error.
+bool write_checkpoint(const CheckpointState& state, const std::string& filename);
+
+// Read and validate only the header (to size a solver before restoring into it)
+bool read_checkpoint_header(const std::string& filename, CheckpointHeader& header);
+
+// Writes checkpoints from a background thread. submit() captures the solver state into
+// an idle buffer on the calling thread (a memory copy) and returns; the file is written
+// while the solver keeps running.
+class CheckpointWriter {
+private:
+    std::thread writer;             // Background write thread
+    std::mutex mutex;               // Guards everything below
+    std::condition_variable state_changed;
+    CheckpointState buffer;         // State being (or about to be) written
+    std::string pending_file;       // Target of 'buffer' (empty = idle; set while queued or writing)
+    bool stopping;                  // Set by the destructor
+    size_t checkpoints_written;     // Files written successfully
+    size_t checkpoints_failed;      // Files that could not be written
+
+    void writer_loop();
+
+public:
+    CheckpointWriter();
+
+    // Finish the pending checkpoint, then stop the writer thread
+    ~CheckpointWriter();
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // Capture 'fluid' and queue it for writing. If the previous checkpoint is still being
+    // written, waits for it when 'wait' is true, otherwise skips this one and returns false.
+    // Instantiated for BasicBLWFluid<float> and BasicBLWFluid<double>.
+    template <typename Scalar>
+    bool submit(const BasicBLWFluid<Scalar>& fluid, const std::string& filename, bool wait = false);
+
+    // Block until no checkpoint is pending
+    void flush();
+
+    size_t get_checkpoints_written();
+    size_t get_checkpoints_failed();
+};
+
+#endif // CHECKPOINT_HPP
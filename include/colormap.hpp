@@ -0,0 +1,61 @@
+#ifndef COLORMAP_HPP
+#define COLORMAP_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Color ramps available for scalar fields
+enum class Palette {
+    BlueGreenRed,  // Classic density ramp (blue → green → red)
+    Grayscale,     // Black → white
+    Viridis,       // Perceptually uniform (matplotlib viridis)
+    CoolWarm       // Diverging blue → white → red
+};
+
+// Maps scalar values to packed RGBA (byte order R, G, B, A in memory) through a
+// precomputed lookup table. Values are clamped to [range_min, range_max].
+// Shared by the live renderer and offline frame export.
+class Colormap {
+public:
+    static const int LUT_SIZE = 256;
+
+private:
+    Palette palette;               // Active color ramp
+    float range_min;               // Value mapped to the first LUT entry
+    float range_max;               // Value mapped to the last LUT entry
+    float scale;                   // (LUT_SIZE - 1) / (range_max - range_min)
+    uint32_t lut[LUT_SIZE];        // Packed RGBA per entry
+    uint32_t masked_color;         // Output for masked (obstacle) cells
+
+    void rebuild_lut();
+
+public:
+    Colormap(Palette palette = Palette::BlueGreenRed, float min = 0.8f, float max = 1.2f);
+
+    void set_palette(Palette new_palette);
+    void set_range(float min, float max);
+    void set_masked_color(uint32_t rgba) { masked_color = rgba; }
+
+    Palette get_palette() const { return palette; }
+    float get_range_min() const { return range_min; }
+    float get_range_max() const { return range_max; }
+
+    // Color of a single value
+    uint32_t map(float value) const;
+
+    // Convert 'count' values to RGBA. Where bit i of the packed mask is set (bit i % 64 of
+    // mask[i / 64], see ObstacleMask) the masked color is written instead (mask may be null).
+    // Uses SSE2/AVX2 when the compiler targets them.
+    void map_field(const float* values, const uint64_t* mask, size_t count, uint32_t* out) const;
+
+    // Parse a palette name ("bgr", "gray", "viridis", "coolwarm"); returns false if unknown
+    static bool palette_from_name(const std::string& name, Palette& out);
+};
+
+// Pack 8-bit channels into the RGBA layout used by Colormap and the fluid texture
+inline uint32_t pack_rgba(uint32_t r, uint32_t g, uint32_t b, uint32_t a = 255) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+#endif // COLORMAP_HPP
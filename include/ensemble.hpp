@@ -0,0 +1,122 @@
+#ifndef ENSEMBLE_HPP
+#define ENSEMBLE_HPP
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <fluid.hpp>
+
+// K simulations of the same grid and obstacles, each with its own viscosity and gravity,
+// advanced together. Values of the K instances are stored next to each other:
+//     populations[(idx * NUM_VELOCITIES + i) * K + k],  density[idx * K + k]
+// so every kernel loop runs over k innermost, over contiguous memory, and the compiler
+// maps it onto SIMD lanes. Small grids that cannot fill the vector units (or cores) on
+// their own then run one sweep of K parameter sets at once. Each instance follows exactly
+// the arithmetic of BasicBLWFluid with native population storage, so instance k matches a
+// standalone solver with the same parameters bit for bit.
+// A step is two sweeps: collision in place, then a pull pass that gathers each cell's
+// populations from its neighbours, applies its bounce-back links and sums its density.
+// Every cell's additions happen in the same order as in BasicBLWFluid's push streaming.
+template <typename Scalar>
+class BasicEnsembleFluid {
+private:
+    int grid_width;               // Number of cells in X direction
+    int grid_height;              // Number of cells in Y direction
+    int instance_count;           // K
+    Scalar cell_size;             // Size of each cell in world units
+    Scalar dt;                    // Time step (calculated from cell size, as in BasicBLWFluid)
+    LatticeLayout layout;         // Cell storage ordering and neighbour index tables
+    SharedObstacleSet obstacle_set; // Obstacles of all instances (immutable, may be shared)
+    std::vector<uint16_t> bounce_dirs; // Per cell: bit i set when link i bounces back (outside grid / obstacle)
+    std::vector<Scalar> populations; // [(idx * NUM_VELOCITIES + i) * K + k]
+    std::vector<Scalar> next_populations; // Streaming target, swapped with 'populations'
+    std::vector<Scalar> density;  // [idx * K + k]
+    std::vector<Scalar> viscosity; // Kinematic viscosity per instance
+    std::vector<Scalar> gravity;  // Gravity (Y) per instance
+    std::vector<Scalar> omega;    // BGK relaxation rate per instance (from viscosity)
+    std::vector<Scalar> gravity_dt; // gravity * dt per instance
+    long step_count;              // Number of completed update() calls
+    std::unique_ptr<ThreadPool> pool; // Threads sharing the cell range
+
+    // Cells per parallel chunk
+    static const size_t CELL_GRAIN = 1024;
+
+    // Instances handled together by the collision and density kernels (fixed trip count
+    // for the vectorizer); the K % LANE_BLOCK remaining instances go one at a time
+    static const int LANE_BLOCK = 16;
+
+    // Recompute omega and gravity_dt after a parameter change
+    void update_rates();
+
+    // Mark the links of fluid cells that point outside the grid or into an obstacle
+    void update_boundary_links();
+
+    // Switch to another obstacle set and rebuild the bounce-back links
+    void use_obstacle_set(SharedObstacleSet set);
+
+    // Kernels for instances [k0, k0 + Lanes) of one cell
+    template <int Lanes>
+    void collide_lanes(size_t idx, int k0);
+    template <int Lanes>
+    void density_lanes(size_t idx, int k0);
+
+    // Streaming, bounce-back and density of one cell, all instances
+    void pull_cell(size_t idx);
+
+public:
+    // One instance per entry of 'viscosities' and 'gravities' (both must have the same,
+    // non-zero length); grid, cell size and ordering are shared
+    BasicEnsembleFluid(int width, int height, Scalar cell_size, const std::vector<Scalar>& viscosities,
+                       const std::vector<Scalar>& gravities, CellOrdering ordering = CellOrdering::RowMajor);
+
+    // Obstacles apply to every instance
+    bool add_obstacle_from_file(const std::string& filename);
+    bool add_obstacle_from_vertices(const std::vector<Vec2>& vertices);
+
+    // Replace all obstacles by a shared set (see BasicBLWFluid::set_obstacles); returns false
+    // when the set was rasterized for another lattice
+    bool set_obstacles(SharedObstacleSet set);
+    const SharedObstacleSet& get_obstacle_set() const { return obstacle_set; }
+
+    // Advance all instances by one time step
+    void update();
+
+    // Copy density, velocity and obstacle fields of one instance (row-major) into 'snapshot'
+    void fill_snapshot(int instance, FieldSnapshot& snapshot) const;
+
+    // Per-instance parameters; changes apply from the next update()
+    void set_parameters(int instance, Scalar viscosity, Scalar gravity);
+    Scalar get_viscosity(int instance) const { return viscosity[instance]; }
+    Scalar get_gravity(int instance) const { return gravity[instance]; }
+
+    // Density of cell idx (storage index) in one instance
+    Scalar get_density(int instance, int idx) const {
+        return density[static_cast<size_t>(idx) * instance_count + instance];
+    }
+    // Distribution function i of cell idx in one instance
+    Scalar get_population(int instance, int idx, int i) const {
+        return populations[(static_cast<size_t>(idx) * NUM_VELOCITIES + i) * instance_count + instance];
+    }
+
+    // Threads used by update() (0 = all hardware threads); results do not depend on the count
+    void set_thread_count(int threads) { pool = std::make_unique<ThreadPool>(threads); }
+    int get_thread_count() const { return pool->size(); }
+
+    int get_instance_count() const { return instance_count; }
+    int cell_index(int x, int y) const { return layout.index(x, y); }
+    int get_grid_width() const { return grid_width; }
+    int get_grid_height() const { return grid_height; }
+    Scalar get_cell_size() const { return cell_size; }
+    long get_step_count() const { return step_count; }
+    const LatticeLayout& get_layout() const { return layout; }
+    const ObstacleMask& get_obstacle_mask() const { return obstacle_set->get_mask(); }
+    size_t get_obstacle_count() const { return obstacle_set->get_obstacle_count(); }
+};
+
+extern template class BasicEnsembleFluid<float>;
+extern template class BasicEnsembleFluid<double>;
+
+using EnsembleFluid = BasicEnsembleFluid<float>;
+using EnsembleFluidDouble = BasicEnsembleFluid<double>;
+
+#endif // ENSEMBLE_HPP
@@ -6,8 +6,20 @@
 #include <stdexcept>
 #include <algorithm>
 #include <string>  
+#include <memory>
+#include <iterator>
 #include <nary_tree.hpp>
 #include <obstacle.hpp>
+#include <obstacle_mask.hpp>
+#include <obstacle_set.hpp>
+#include <lattice_layout.hpp>
+#include <lattice_memory.hpp>
+#include <population_storage.hpp>
+#include <parallel.hpp>
+#include <snapshot.hpp>
+#include <checkpoint.hpp>
+#include <profiler.hpp>
+#include <trace.hpp>
 
 // Lattice Boltzmann D2Q9 model parameters (2D, 9 velocity directions)
 const int NUM_VELOCITIES = 9;
@@ -16,62 +28,204 @@ const float W[NUM_VELOCITIES] = {4.0f/9.0f, 1.0f/9.0f, 1.0f/9.0f, 1.0f/9.0f, 1.0
 const int CX[NUM_VELOCITIES] = {0, 1, 0, -1, 0, 1, -1, -1, 1}; // X velocity components
 const int CY[NUM_VELOCITIES] = {0, 0, 1, 0, -1, 1, 1, -1, -1}; // Y velocity components
 
-// Structure representing a single fluid cell
-struct FluidCell {
-    Vec2 pos;                     // Cell position in world space
-    float density;                // Macroscopic density
-    float velocity[NUM_VELOCITIES]; // Distribution function for each velocity direction
-    bool is_obstacle;             // Whether the cell is an obstacle
+// Weights in the solver's scalar type (W converted to double would keep float rounding)
+template <typename Scalar>
+inline constexpr Scalar LATTICE_WEIGHTS[NUM_VELOCITIES] = {
+    Scalar(4) / Scalar(9), Scalar(1) / Scalar(9), Scalar(1) / Scalar(9), Scalar(1) / Scalar(9), Scalar(1) / Scalar(9),
+    Scalar(1) / Scalar(36), Scalar(1) / Scalar(36), Scalar(1) / Scalar(36), Scalar(1) / Scalar(36)};
+
+// Pass as tree_arity to benchmark all supported arities on the grid and keep the fastest
+const int TREE_ARITY_AUTO = 0;
+
+// Structure representing a single fluid cell.
+// The distribution functions live in separate arrays in BasicBLWFluid, stored in the
+// precision selected at construction. Positions are not stored (see CellPositions), nor
+// is the obstacle flag (see BasicBLWFluid::get_obstacle_mask).
+template <typename Scalar>
+struct BasicFluidCell {
+    Scalar density;               // Macroscopic density
     
-    // Constructor: Initialize default values
-    FluidCell() : density(1.0f), is_obstacle(false) {
-        // Initialize all velocities to 0.0f
-        for (int i = 0; i < NUM_VELOCITIES; ++i) {
-            velocity[i] = 0.0f;
-        }
+    // Default construction leaves density unset, so a new lattice is not written before its
+    // parallel first touch; BasicBLWFluid starts every cell at density 1
+    BasicFluidCell() = default;
+    explicit BasicFluidCell(Scalar density) : density(density) {}
+};
+
+// World-space positions of the cells, computed from storage indices on access:
+// positions[idx] = (x, y) * cell_size for the cell at layout.index(x, y).
+// Iterating yields the positions in storage order, matching get_cells().
+class CellPositions {
+private:
+    const LatticeLayout* layout;  // Maps storage indices back to lattice coordinates
+    float cell_size;              // World units per cell
+
+public:
+    class iterator {
+    private:
+        const CellPositions* view;
+        int idx;
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Vec2;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Vec2;
+
+        iterator() : view(nullptr), idx(0) {}
+        iterator(const CellPositions* view, int idx) : view(view), idx(idx) {}
+
+        Vec2 operator*() const { return (*view)[idx]; }
+        iterator& operator++() { ++idx; return *this; }
+        iterator operator++(int) { iterator old = *this; ++idx; return old; }
+        bool operator==(const iterator& other) const { return idx == other.idx; }
+        bool operator!=(const iterator& other) const { return idx != other.idx; }
+        int index() const { return idx; } // Storage index of the current cell
+    };
+
+    CellPositions(const LatticeLayout& layout, float cell_size) : layout(&layout), cell_size(cell_size) {}
+
+    Vec2 operator[](int idx) const {
+        return Vec2(layout->cell_x(idx) * cell_size, layout->cell_y(idx) * cell_size);
     }
+    size_t size() const { return static_cast<size_t>(layout->get_cell_count()); }
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, layout->get_cell_count()); }
+};
+
+// Global flow quantities of one time step, accumulated in double inside the density and
+// bounce-back passes (see BasicBLWFluid::set_diagnostics_enabled)
+struct FlowDiagnostics {
+    long step = 0;                // Step the values belong to
+    double mass = 0.0;            // Sum of all populations over fluid cells (before the density clamp)
+    double momentum_x = 0.0;      // Sum of populations times lattice velocity
+    double momentum_y = 0.0;
+    double kinetic_energy = 0.0;  // Sum of |momentum|^2 / (2 * population sum) per cell
+    double drag_x = 0.0;          // Momentum given to obstacles by bounce-back (grid edges excluded)
+    double drag_y = 0.0;
 };
 
-// BLW (Boltzmann Lattice Weighted) fluid simulation class
-class BLWFluid {
+// BLW (Boltzmann Lattice Weighted) fluid simulation class.
+// Scalar is the arithmetic type of the kernel and of the macroscopic fields: float, or
+// double for long runs where float round-off accumulates. Both are instantiated in
+// src/fluid/fluid.cpp; BLWFluid is the float solver used by the renderer.
+template <typename Scalar>
+class BasicBLWFluid {
+public:
+    using Cell = BasicFluidCell<Scalar>;
+
 private:
     int grid_width;               // Number of cells in X direction
     int grid_height;              // Number of cells in Y direction
-    float cell_size;              // Size of each cell in world units
-    std::vector<FluidCell> cells; // Grid of fluid cells
-    ObstacleManager obstacle_manager; // Obstacle manager
-    NaryTree<4> spatial_tree;     // 4-ary tree for neighbor queries
+    Scalar cell_size;             // Size of each cell in world units
+    LatticeLayout layout;         // Cell storage ordering and neighbour index tables
+    LatticeVector<Cell> cells;    // Grid of fluid cells (indexed by layout.index(x, y))
+    SharedObstacleSet obstacle_set; // Polygons + 1 bit per cell in storage order (immutable, may be shared)
+    PopulationPrecision precision; // Storage format of the populations
+    LatticeVector<double> wide_populations; // FP64: distribution functions [idx * NUM_VELOCITIES + i]
+    LatticeVector<float> populations; // FP32: same indexing
+    LatticeVector<uint16_t> packed_populations; // FP16 / BF16: same indexing, f - W[i] in 16 bits
+    LatticeVector<double> wide_next; // Streaming target of the active format, swapped with it every step
+    LatticeVector<float> next_populations;
+    LatticeVector<uint16_t> packed_next;
+    HugePageMode huge_pages;      // Page backing of the lattice buffers
+    std::unique_ptr<SpatialIndex> spatial_tree; // N-ary tree for neighbor queries (arity chosen at runtime)
     
     // Fluid physical parameters
-    float kinematic_viscosity;    // Viscosity of the fluid
-    float dt;                     // Time step (calculated from cell size)
-    float gravity;                // Gravitational acceleration (Y direction)
+    Scalar kinematic_viscosity;   // Viscosity of the fluid
+    Scalar dt;                    // Time step (calculated from cell size)
+    Scalar gravity;               // Gravitational acceleration (Y direction)
+    long step_count;              // Number of completed update() calls
+    unsigned long obstacle_revision; // Bumped whenever the obstacle mask changes
+    std::vector<int32_t> boundary_links; // Bounce-back links as idx * NUM_VELOCITIES + i (see update_boundary_links)
+    mutable PhaseProfiler profiler; // Per-phase timers (mutable: const queries are timed too)
+    std::unique_ptr<ThreadPool> pool; // Threads sharing the collision, streaming and density passes
+    bool diagnostics_enabled;     // Accumulate FlowDiagnostics during update()
+    FlowDiagnostics diagnostics;  // Values of the last step (when enabled)
     
-    // Calculate equilibrium distribution function
-    void compute_equilibrium(FluidCell& cell, float ux, float uy) {
-        if (cell.is_obstacle) return;
-        
-        float u_sq = ux * ux + uy * uy;
-        for (int i = 0; i < NUM_VELOCITIES; ++i) {
-            float cu = CX[i] * ux + CY[i] * uy; // Dot product of velocity and direction
-            cell.velocity[i] = W[i] * cell.density * (1.0f + 3.0f * cu + 4.5f * cu * cu - 1.5f * u_sq);
+    // Cells per parallel chunk. Fixed, so chunked reductions do not depend on the thread count.
+    static const size_t KERNEL_GRAIN = 4096;
+    
+    // Per-chunk partial sums of the density pass
+    struct DiagnosticSums {
+        double mass = 0.0;
+        double momentum_x = 0.0;
+        double momentum_y = 0.0;
+        double kinetic_energy = 0.0;
+    };
+    std::vector<DiagnosticSums> diagnostic_chunks; // One entry per KERNEL_GRAIN cells
+    bool field_output_enabled;    // Write the velocity planes during update()
+    long field_step;              // Step the velocity planes belong to (-1 = stale)
+    LatticeVector<Scalar> velocity_x; // Macroscopic velocity after the last step [storage idx] (SoA plane)
+    LatticeVector<Scalar> velocity_y;
+    
+    // Bytes moved per lattice update for the profiler's bandwidth estimate
+    void configure_profiler();
+    
+    // Replace 'buffer' (per_cell elements per cell) by a new one with the current page backing,
+    // filled in KERNEL_GRAIN chunks by fill(placed, begin, end) for elements [begin, end). Under
+    // a static thread placement every page is first touched by the thread that owns its chunk
+    // in update(), so it lands on that thread's NUMA node.
+    template <typename T, typename Fill>
+    void place_buffer(LatticeVector<T>& buffer, size_t per_cell, Fill&& fill) {
+        const size_t count = static_cast<size_t>(grid_width) * grid_height;
+        LatticeVector<T> placed{LatticeAllocator<T>(huge_pages)};
+        placed.resize(count * per_cell);
+        pool->parallel_for(count, KERNEL_GRAIN, [&](size_t begin, size_t end) {
+            fill(placed.data(), begin * per_cell, end * per_cell);
+        });
+        buffer.swap(placed);
+    }
+    
+    // Move cells, populations (and their streaming target) and velocity planes to freshly
+    // placed buffers (same contents)
+    void place_lattice();
+    
+    // Streaming target of the same storage type as 'f' (only the active format's is allocated)
+    LatticeVector<double>& streaming_target(LatticeVector<double>&) { return wide_next; }
+    LatticeVector<float>& streaming_target(LatticeVector<float>&) { return next_populations; }
+    LatticeVector<uint16_t>& streaming_target(LatticeVector<uint16_t>&) { return packed_next; }
+    
+    // Call fn(codec, storage) with the codec type and population array of the active precision
+    template <typename Fn>
+    decltype(auto) with_populations(Fn&& fn) {
+        switch (precision) {
+            case PopulationPrecision::FP64: return fn(Fp64Populations<Scalar>(), wide_populations);
+            case PopulationPrecision::FP16: return fn(Fp16Populations<Scalar>(), packed_populations);
+            case PopulationPrecision::BF16: return fn(Bf16Populations<Scalar>(), packed_populations);
+            default:                        return fn(Fp32Populations<Scalar>(), populations);
+        }
+    }
+    template <typename Fn>
+    decltype(auto) with_populations(Fn&& fn) const {
+        switch (precision) {
+            case PopulationPrecision::FP64: return fn(Fp64Populations<Scalar>(), wide_populations);
+            case PopulationPrecision::FP16: return fn(Fp16Populations<Scalar>(), packed_populations);
+            case PopulationPrecision::BF16: return fn(Bf16Populations<Scalar>(), packed_populations);
+            default:                        return fn(Fp32Populations<Scalar>(), populations);
         }
     }
     
-    // Perform collision step (BGK model)
-    void collision(FluidCell& cell) {
-        if (cell.is_obstacle) return;
+    // Perform collision step (BGK model) on the populations 'f' of one cell.
+    // Populations are converted to Scalar once, relaxed in registers and stored back.
+    template <typename Codec>
+    void collision(Cell& cell, typename Codec::Stored* f) {
+        const Scalar* w = LATTICE_WEIGHTS<Scalar>;
+        Scalar fi[NUM_VELOCITIES];
+        for (int i = 0; i < NUM_VELOCITIES; ++i) {
+            fi[i] = Codec::load(f[i], w[i]);
+        }
         
         // Calculate macroscopic velocity (ux, uy)
-        float ux = 0.0f, uy = 0.0f;
+        Scalar ux = 0, uy = 0;
         for (int i = 0; i < NUM_VELOCITIES; ++i) {
-            ux += CX[i] * cell.velocity[i];
-            uy += CY[i] * cell.velocity[i];
+            ux += CX[i] * fi[i];
+            uy += CY[i] * fi[i];
         }
         
         // Avoid division by zero (should not happen with valid density)
         if (std::fabs(cell.density) < 1e-6) {
-            cell.density = 1.0f;
+            cell.density = 1;
         }
         ux /= cell.density;
         uy /= cell.density;
@@ -80,130 +234,344 @@ private:
         uy += gravity * dt;
         
         // Calculate equilibrium distribution
-        float feq[NUM_VELOCITIES];
-        float u_sq = ux * ux + uy * uy;
+        Scalar feq[NUM_VELOCITIES];
+        Scalar u_sq = ux * ux + uy * uy;
         for (int i = 0; i < NUM_VELOCITIES; ++i) {
-            float cu = CX[i] * ux + CY[i] * uy;
-            feq[i] = W[i] * cell.density * (1.0f + 3.0f * cu + 4.5f * cu * cu - 1.5f * u_sq);
+            Scalar cu = CX[i] * ux + CY[i] * uy;
+            feq[i] = w[i] * cell.density * (Scalar(1) + Scalar(3) * cu + Scalar(4.5) * cu * cu - Scalar(1.5) * u_sq);
         }
         
         // BGK collision: relax towards equilibrium
-        float tau = 0.5f + (kinematic_viscosity * dt) / (cell_size * cell_size);
-        float omega = 1.0f / tau; // Relaxation parameter
+        Scalar tau = Scalar(0.5) + (kinematic_viscosity * dt) / (cell_size * cell_size);
+        Scalar omega = Scalar(1) / tau; // Relaxation parameter
         for (int i = 0; i < NUM_VELOCITIES; ++i) {
-            cell.velocity[i] = (1.0f - omega) * cell.velocity[i] + omega * feq[i];
+            f[i] = Codec::store((Scalar(1) - omega) * fi[i] + omega * feq[i], w[i]);
         }
     }
     
-    // Perform streaming step (move distribution functions between cells)
-    void streaming() {
-        std::vector<FluidCell> new_cells = cells; // Copy current state
-        
-        for (int y = 0; y < grid_height; ++y) {
-            for (int x = 0; x < grid_width; ++x) {
-                int idx = y * grid_width + x;
-                if (cells[idx].is_obstacle) continue;
-                
-                // Stream to neighboring cells for each velocity direction
-                for (int i = 0; i < NUM_VELOCITIES; ++i) {
-                    int nx = x + CX[i];
-                    int ny = y + CY[i];
+    // Perform streaming step (move distribution functions between cells).
+    // Bulk links and bounce-back links run as separate passes so they can be timed apart.
+    template <typename Codec>
+    void streaming(LatticeVector<typename Codec::Stored>& f) {
+        const Scalar* w = LATTICE_WEIGHTS<Scalar>;
+        const ObstacleMask& obstacles = obstacle_set->get_mask();
+        LatticeVector<typename Codec::Stored>& next = streaming_target(f); // Placed with f by place_lattice()
+        {
+            PhaseProfiler::Scope timer(profiler, ProfilePhase::Streaming);
+            
+            // Walk fluid cells in storage order; neighbours come from the layout's index table.
+            // Slot (nidx, i) is only written by the cell nidx - c_i, so chunks never collide.
+            pool->parallel_for(cells.size(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+                // Copy current state
+                std::copy(f.begin() + begin * NUM_VELOCITIES, f.begin() + end * NUM_VELOCITIES,
+                          next.begin() + begin * NUM_VELOCITIES);
+            });
+            pool->parallel_for(cells.size(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+                obstacles.for_each_fluid(begin, end, [&](size_t idx) {
+                    const int32_t* neighbors = layout.neighbors(static_cast<int>(idx));
+                    const size_t base = idx * NUM_VELOCITIES;
                     
-                    // Boundary check: apply bounce-back if out of bounds
-                    if (nx < 0 || nx >= grid_width || ny < 0 || ny >= grid_height) {
-                        int bounce_i = (i % 4 == 0) ? i : (i + 2) % 4; // Reverse direction
-                        new_cells[idx].velocity[bounce_i] += cells[idx].velocity[i];
-                    } else {
-                        int nidx = ny * grid_width + nx;
-                        // Bounce-back if neighboring cell is an obstacle
-                        if (new_cells[nidx].is_obstacle) {
-                            int bounce_i = (i % 4 == 0) ? i : (i + 2) % 4;
-                            new_cells[idx].velocity[bounce_i] += cells[idx].velocity[i];
-                        } else {
-                            new_cells[nidx].velocity[i] += cells[idx].velocity[i];
-                        }
+                    // Stream to neighboring fluid cells; the other links are in boundary_links
+                    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                        int nidx = neighbors[i];
+                        if (nidx < 0 || obstacles.test(nidx)) continue;
+                        auto& target = next[static_cast<size_t>(nidx) * NUM_VELOCITIES + i];
+                        target = Codec::store(Codec::load(target, w[i]) + Codec::load(f[base + i], w[i]), w[i]);
                     }
+                });
+            });
+        }
+        
+        {
+            // Bounce-back if out of bounds or neighboring cell is an obstacle.
+            // Serial: several links of a cell can bounce into the same slot.
+            PhaseProfiler::Scope timer(profiler, ProfilePhase::Boundary);
+            double drag_x = 0.0, drag_y = 0.0;
+            for (int32_t link : boundary_links) {
+                int idx = link / NUM_VELOCITIES;
+                int i = link % NUM_VELOCITIES;
+                int bounce_i = (i % 4 == 0) ? i : (i + 2) % 4; // Reverse direction
+                Scalar outgoing = Codec::load(f[link], w[i]);
+                auto& target = next[static_cast<size_t>(idx) * NUM_VELOCITIES + bounce_i];
+                target = Codec::store(Codec::load(target, w[bounce_i]) + outgoing, w[bounce_i]);
+                
+                // Momentum exchange with obstacles: c_i leaves, c_bounce_i comes back
+                if (diagnostics_enabled && layout.neighbors(idx)[i] >= 0) {
+                    drag_x += static_cast<double>(outgoing) * (CX[i] - CX[bounce_i]);
+                    drag_y += static_cast<double>(outgoing) * (CY[i] - CY[bounce_i]);
                 }
             }
+            diagnostics.drag_x = drag_x;
+            diagnostics.drag_y = drag_y;
         }
         
-        cells = new_cells; // Update to new state
+        f.swap(next); // Update to new state; the old one is the next step's target
     }
     
-    // Update obstacle status for all cells (call after adding obstacles)
-    void update_obstacle_cells() {
-        for (int y = 0; y < grid_height; ++y) {
-            for (int x = 0; x < grid_width; ++x) {
-                int idx = y * grid_width + x;
-                cells[idx].is_obstacle = obstacle_manager.is_point_obstructed(cells[idx].pos);
+    // Collect the links of fluid cells that point outside the grid or into an obstacle
+    void update_boundary_links() {
+        const ObstacleMask& obstacles = obstacle_set->get_mask();
+        boundary_links.clear();
+        obstacles.for_each_fluid(0, cells.size(), [&](size_t cell) {
+            const int idx = static_cast<int>(cell);
+            const int32_t* neighbors = layout.neighbors(idx);
+            for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                if (neighbors[i] < 0 || obstacles.test(neighbors[i])) {
+                    boundary_links.push_back(idx * NUM_VELOCITIES + i);
+                }
             }
-        }
+        });
     }
     
-    // Update macroscopic density from distribution functions
-    void update_density() {
-        for (auto& cell : cells) {
-            if (cell.is_obstacle) continue;
-            
-            cell.density = 0.0f;
+    // Switch to another obstacle set (call after any obstacle change)
+    void use_obstacle_set(SharedObstacleSet set) {
+        obstacle_set = std::move(set);
+        obstacle_revision++; // Snapshots and the renderer re-read the mask
+        field_step = -1;     // New obstacle cells still hold their old velocity
+        update_boundary_links();
+    }
+
+    // Copy of the current polygons plus one more; the shared set itself never changes
+    template <typename AddFn>
+    bool add_obstacle(AddFn&& add) {
+        ObstacleManager geometry = obstacle_set->get_geometry();
+        if (!add(geometry)) return false;
+        use_obstacle_set(std::make_shared<const ObstacleSet>(std::move(geometry), layout, static_cast<float>(cell_size)));
+        return true;
+    }
+    
+    // Update macroscopic density from distribution functions for cells [begin, end).
+    // With Diagnostics, mass, momentum and kinetic energy of the range are summed in double
+    // while the populations are in registers anyway; with Fields, the velocity planes are
+    // written from the same loads. The diagnostics use the population sum itself, not the
+    // clamped density the kernel continues with, so they show mass drift.
+    template <typename Codec, bool Diagnostics, bool Fields>
+    void update_density_range(const LatticeVector<typename Codec::Stored>& f, size_t begin, size_t end,
+                              DiagnosticSums* sums) {
+        const Scalar* w = LATTICE_WEIGHTS<Scalar>;
+        const ObstacleMask& obstacles = obstacle_set->get_mask();
+        if constexpr (Fields) {
+            obstacles.for_each_obstacle(begin, end, [this](size_t idx) { velocity_x[idx] = velocity_y[idx] = 0; });
+        }
+        obstacles.for_each_fluid(begin, end, [&](size_t idx) {
+            Cell& cell = cells[idx];
+            Scalar sum = 0, jx = 0, jy = 0;
             for (int i = 0; i < NUM_VELOCITIES; ++i) {
-                cell.density += cell.velocity[i];
+                Scalar fi = Codec::load(f[idx * NUM_VELOCITIES + i], w[i]);
+                sum += fi;
+                if constexpr (Diagnostics || Fields) {
+                    jx += CX[i] * fi;
+                    jy += CY[i] * fi;
+                }
+            }
+            cell.density = std::clamp(sum, Scalar(0.5), Scalar(1.5));
+            
+            if constexpr (Fields) {
+                // Same guard as the velocity in collision() and fill_snapshot()
+                const bool valid = std::fabs(cell.density) >= 1e-6;
+                velocity_x[idx] = valid ? jx / cell.density : Scalar(0);
+                velocity_y[idx] = valid ? jy / cell.density : Scalar(0);
+            }
+            if constexpr (Diagnostics) {
+                const double rho = sum;
+                sums->mass += rho;
+                sums->momentum_x += jx;
+                sums->momentum_y += jy;
+                if (rho != 0.0) {
+                    sums->kinetic_energy += (static_cast<double>(jx) * jx + static_cast<double>(jy) * jy) / (2.0 * rho);
+                }
             }
-            cell.density = std::clamp(cell.density, 0.5f, 1.5f);
+        });
+    }
+    
+    template <typename Codec, bool Diagnostics>
+    void update_density_chunks(const LatticeVector<typename Codec::Stored>& f) {
+        pool->parallel_for(cells.size(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+            DiagnosticSums* sums = Diagnostics ? &diagnostic_chunks[begin / KERNEL_GRAIN] : nullptr;
+            if (field_output_enabled) update_density_range<Codec, Diagnostics, true>(f, begin, end, sums);
+            else update_density_range<Codec, Diagnostics, false>(f, begin, end, sums);
+        });
+        field_step = field_output_enabled ? step_count + 1 : -1;
+    }
+    
+    template <typename Codec>
+    void update_density(const LatticeVector<typename Codec::Stored>& f) {
+        if (!diagnostics_enabled) {
+            update_density_chunks<Codec, false>(f);
+            return;
+        }
+        
+        // Each chunk sums into its own slot; the slots are then added pairwise in chunk order
+        diagnostic_chunks.assign(ThreadPool::chunk_count(cells.size(), KERNEL_GRAIN), DiagnosticSums());
+        update_density_chunks<Codec, true>(f);
+        
+        const size_t chunks = diagnostic_chunks.size();
+        std::vector<double> values(chunks);
+        auto total = [&](double DiagnosticSums::*field) {
+            for (size_t c = 0; c < chunks; ++c) values[c] = diagnostic_chunks[c].*field;
+            return pairwise_sum(values.data(), chunks);
+        };
+        diagnostics.mass = total(&DiagnosticSums::mass);
+        diagnostics.momentum_x = total(&DiagnosticSums::momentum_x);
+        diagnostics.momentum_y = total(&DiagnosticSums::momentum_y);
+        diagnostics.kinetic_energy = total(&DiagnosticSums::kinetic_energy);
+        diagnostics.step = step_count + 1;
+    }
+    
+    // One time step for a given population codec
+    template <typename Codec>
+    void step(LatticeVector<typename Codec::Stored>& f) {
+        // 1. Collision step
+        {
+            PhaseProfiler::Scope timer(profiler, ProfilePhase::Collision);
+            const ObstacleMask& obstacles = obstacle_set->get_mask();
+            pool->parallel_for(cells.size(), KERNEL_GRAIN, [&](size_t begin, size_t end) {
+                obstacles.for_each_fluid(begin, end, [&](size_t idx) {
+                    collision<Codec>(cells[idx], &f[idx * NUM_VELOCITIES]);
+                });
+            });
+        }
+        
+        // 2. Streaming step (bulk + boundary)
+        streaming<Codec>(f);
+        
+        // 3. Update macroscopic properties
+        {
+            PhaseProfiler::Scope timer(profiler, ProfilePhase::Density);
+            update_density<Codec>(f);
         }
     }
 
 public:
-    // Ensure initialization order matches declaration order (obstacle_manager before spatial_tree)
     // Constructor is declared here; implementation is in src/fluid/fluid.cpp to avoid duplicate definition
-    BLWFluid(int width, int height, float cell_size, float viscosity, float gravity);
+    // ordering selects the memory layout of 'cells' (see lattice_layout.hpp);
+    // tree_arity is one of SUPPORTED_TREE_ARITIES or TREE_ARITY_AUTO;
+    // precision selects the population storage format (see population_storage.hpp)
+    BasicBLWFluid(int width, int height, Scalar cell_size, Scalar viscosity, Scalar gravity,
+                  CellOrdering ordering = CellOrdering::RowMajor, int tree_arity = 4,
+                  PopulationPrecision precision = native_precision<Scalar>());
     
     // Destructor: Default (vector and tree handle memory automatically)
-    ~BLWFluid() = default;
+    ~BasicBLWFluid() = default;
 
+    // Adding an obstacle re-rasterizes into a new set owned by this solver only
     bool add_obstacle_from_file(const std::string& filename) {
-        // Ensure obstacle_manager is correctly declared
-        bool success = obstacle_manager.add_obstacle_from_file(filename);
-        if (success) {
-            update_obstacle_cells(); // Update cell obstacle status
-        }
-        return success;
+        return add_obstacle([&](ObstacleManager& geometry) { return geometry.add_obstacle_from_file(filename); });
     }
     
     // Add obstacle from vertex list
     bool add_obstacle_from_vertices(const std::vector<Vec2>& vertices) {
-        // Ensure obstacle_manager is correctly declared
-        bool success = obstacle_manager.add_obstacle_from_vertices(vertices);
-        if (success) {
-            update_obstacle_cells();
-        }
-        return success;
+        return add_obstacle([&](ObstacleManager& geometry) { return geometry.add_obstacle_from_vertices(vertices); });
     }
     
+    // Replace all obstacles by a shared set (see obstacle_set.hpp). Nothing is copied or
+    // re-voxelized, so any number of solvers on the same geometry hold one set. Returns false
+    // when the set was rasterized for another grid, cell size or ordering.
+    bool set_obstacles(SharedObstacleSet set) {
+        if (!set || !set->matches(layout, static_cast<float>(cell_size))) {
+            std::cerr << "[ERROR] Fluid: Obstacle set does not match the grid" << std::endl;
+            return false;
+        }
+        use_obstacle_set(std::move(set));
+        return true;
+    }
+    const SharedObstacleSet& get_obstacle_set() const { return obstacle_set; }
+
     // Update fluid simulation by one time step
     void update() {
-        // 1. Collision step
-        for (auto& cell : cells) {
-            collision(cell);
-        }
-        
-        // 2. Streaming step
-        streaming();
-        
-        // 3. Update macroscopic properties
-        update_density();
+        TRACE_SCOPE("update", "solver");
+        with_populations([this](auto codec, auto& f) { step<decltype(codec)>(f); });
+        step_count++;
+        profiler.add_step();
     }
     
+    // Copy density, velocity and obstacle fields (row-major) into 'snapshot'.
+    // Buffers are reused, so filling the same snapshot repeatedly does not allocate.
+    // The obstacle mask is only copied when the snapshot holds an older revision.
+    // Velocity comes from the field planes when they are current, otherwise it is
+    // recomputed from the populations.
+    void fill_snapshot(FieldSnapshot& snapshot) const;
+    
+    // Checkpoint / restart (src/fluid/checkpoint.cpp). capture_checkpoint() copies populations,
+    // density, the obstacle mask, polygons and parameters; save_checkpoint() also writes them.
+    // restore_checkpoint() maps the file and copies the state back (grid size and cell size must
+    // match) without re-voxelizing obstacles. Both file operations return false on error.
+    void capture_checkpoint(CheckpointState& state) const;
+    bool save_checkpoint(const std::string& filename) const;
+    bool restore_checkpoint(const std::string& filename);
+    
     // Getters for rendering
-    const std::vector<FluidCell>& get_cells() const { return cells; }
+    const LatticeVector<Cell>& get_cells() const { return cells; }
+    const ObstacleMask& get_obstacle_mask() const { return obstacle_set->get_mask(); } // Storage order
+    bool is_obstacle(int idx) const { return obstacle_set->get_mask().test(idx); }   // Cell at storage index idx
+    const LatticeLayout& get_layout() const { return layout; }
+    PopulationPrecision get_precision() const { return precision; }
+    
+    // Distribution function i of the cell at storage index idx, converted to Scalar
+    Scalar get_population(int idx, int i) const {
+        const size_t k = static_cast<size_t>(idx) * NUM_VELOCITIES + i;
+        return with_populations([k, i](auto codec, const auto& f) {
+            return decltype(codec)::load(f[k], LATTICE_WEIGHTS<Scalar>[i]);
+        });
+    }
+    int cell_index(int x, int y) const { return layout.index(x, y); } // Storage index of cell (x, y)
+    
+    // World position of the cell at storage index idx (computed, not stored)
+    Vec2 get_cell_position(int idx) const { return get_cell_positions()[idx]; }
+    CellPositions get_cell_positions() const { return CellPositions(layout, static_cast<float>(cell_size)); }
+    int get_tree_arity() const { return spatial_tree->arity(); }
+    
+    // Storage indices of cells inside a world-space rectangle (via the spatial tree)
+    std::vector<size_t> query_cells(const Vec2& min, const Vec2& max) const {
+        PhaseProfiler::Scope timer(profiler, ProfilePhase::Tree);
+        return spatial_tree->query_range(min, max);
+    }
     int get_grid_width() const { return grid_width; }
     int get_grid_height() const { return grid_height; }
-    float get_cell_size() const { return cell_size; }
-    float get_viscosity() const { return kinematic_viscosity; }
+    Scalar get_cell_size() const { return cell_size; }
+    Scalar get_viscosity() const { return kinematic_viscosity; }
+    long get_step_count() const { return step_count; }
+    unsigned long get_obstacle_revision() const { return obstacle_revision; }
+    PhaseProfiler& get_profiler() const { return profiler; } // Also used by the renderer (thread-safe)
+    
+    // Threads used by update() (0 = all hardware threads). Results do not depend on the count
+    // or the placement. A Static or Pinned placement (see parallel.hpp) also copies the lattice
+    // into new buffers first touched by the threads that will work on them: on a multi-socket
+    // machine each row band then sits in the memory of the socket that updates it.
+    void set_thread_count(int threads, ThreadPlacement placement = ThreadPlacement::Dynamic);
+    int get_thread_count() const { return pool->size(); }
+    ThreadPlacement get_thread_placement() const { return pool->get_placement(); }
+    
+    // Page backing of the lattice buffers (see lattice_memory.hpp); changing it moves the lattice
+    void set_huge_pages(HugePageMode mode);
+    HugePageMode get_huge_pages() const { return huge_pages; }
+    
+    // Write the macroscopic velocity planes inside update() (on by default). Disabling frees the
+    // planes and saves two stores per cell; snapshots then recompute velocity from the populations.
+    void set_field_output_enabled(bool enabled);
+    bool get_field_output_enabled() const { return field_output_enabled; }
+    
+    // Velocity planes in storage order (index with cell_index(x, y)), written by the last update().
+    // Only valid while has_velocity_field() is true: field output enabled and no obstacle change
+    // or restart since that update.
+    bool has_velocity_field() const { return field_step == step_count; }
+    const LatticeVector<Scalar>& get_velocity_x() const { return velocity_x; }
+    const LatticeVector<Scalar>& get_velocity_y() const { return velocity_y; }
+    
+    // Compute FlowDiagnostics inside update() (no extra pass over the grid; off by default)
+    void set_diagnostics_enabled(bool enabled) { diagnostics_enabled = enabled; }
+    bool get_diagnostics_enabled() const { return diagnostics_enabled; }
+    const FlowDiagnostics& get_diagnostics() const { return diagnostics; }
     size_t get_obstacle_count() const { 
-        // 修复：obstacle_manager 已正确声明
-        return obstacle_manager.get_obstacle_count(); 
+        return obstacle_set->get_obstacle_count(); 
     }
 };
 
+extern template class BasicBLWFluid<float>;
+extern template class BasicBLWFluid<double>;
+
+using FluidCell = BasicFluidCell<float>;
+using BLWFluid = BasicBLWFluid<float>;
+using BLWFluidDouble = BasicBLWFluid<double>;
+
 #endif // FLUID_HPP
\ No newline at end of file
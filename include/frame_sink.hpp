@@ -0,0 +1,104 @@
+#ifndef FRAME_SINK_HPP
+#define FRAME_SINK_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <snapshot.hpp>
+#include <colormap.hpp>
+
+// Scalar field rendered into exported frames
+enum class FrameField {
+    Density,    // Macroscopic density
+    Speed,      // |u| = sqrt(ux^2 + uy^2)
+    Vorticity   // dUy/dx - dUx/dy (central differences, lattice units)
+};
+
+// Output encoding of exported frames
+enum class FrameFormat {
+    PPM,        // One binary PPM (P6) per frame
+    Y4M,        // Single raw YUV4MPEG2 stream (4:4:4), readable by ffmpeg/mpv
+    PNG         // One uncompressed PNG per frame
+};
+
+// Frame export settings
+struct FrameSinkConfig {
+    std::string output_dir = "output";  // Created if missing
+    FrameField field = FrameField::Density;
+    FrameFormat format = FrameFormat::PPM;
+    Palette palette = Palette::BlueGreenRed;
+    float range_min = 0.8f;             // Field value mapped to the start of the ramp
+    float range_max = 1.2f;             // Field value mapped to the end of the ramp
+    int frame_rate = 30;                // Y4M header frame rate (frames per second)
+    size_t queue_capacity = 8;          // Snapshots waiting for the writer thread
+    bool block_when_full = false;       // true: submit() waits for space, false: drop the frame
+};
+
+// Writes snapshots to image files from a background thread. submit() only copies the
+// snapshot into a recycled queue slot; colorizing, encoding and file I/O all happen on
+// the writer thread, so a slow disk never stalls the solver (frames are dropped instead,
+// unless block_when_full is set).
+class FrameSink {
+private:
+    FrameSinkConfig config;
+    Colormap colormap;                  // Used by the writer thread only
+
+    std::thread writer;                 // Background encoder thread
+    std::mutex mutex;                   // Guards everything below
+    std::condition_variable queue_changed;
+    std::deque<FieldSnapshot> pending;  // Snapshots waiting to be written (oldest first)
+    std::vector<FieldSnapshot> spare;   // Written snapshots kept for reuse (buffers stay allocated)
+    bool stopping;                      // Set by the destructor; the writer drains 'pending' and exits
+    bool busy;                          // Writer is encoding a frame outside the lock
+    size_t frames_written;              // Frames successfully written
+    size_t frames_dropped;              // Frames rejected because the queue was full
+    size_t frames_failed;               // Frames that could not be written
+
+    // Writer thread state
+    std::ofstream stream;               // Open Y4M stream
+    int stream_width;                   // Frame size declared in the Y4M header
+    int stream_height;
+    std::vector<float> values;          // Field being exported
+    std::vector<uint32_t> rgba;         // Colorized field
+    std::vector<uint8_t> bytes;         // Encoded output staging buffer
+
+    void writer_loop();
+    bool write_frame(const FieldSnapshot& snapshot);
+    void compute_field(const FieldSnapshot& snapshot);
+    bool write_ppm(const FieldSnapshot& snapshot, const std::string& path);
+    bool write_png(const FieldSnapshot& snapshot, const std::string& path);
+    bool write_y4m(const FieldSnapshot& snapshot);
+    std::string frame_path(long step, const char* extension) const;
+
+public:
+    // Start the writer thread; throws std::runtime_error if output_dir cannot be created
+    explicit FrameSink(const FrameSinkConfig& config);
+
+    // Write every queued frame, then stop the writer thread
+    ~FrameSink();
+
+    FrameSink(const FrameSink&) = delete;
+    FrameSink& operator=(const FrameSink&) = delete;
+
+    // Queue a copy of 'snapshot'. Returns false if the frame was dropped (queue full).
+    bool submit(const FieldSnapshot& snapshot);
+
+    // Block until every queued frame has been written
+    void flush();
+
+    size_t get_frames_written();
+    size_t get_frames_dropped();
+    size_t get_frames_failed();
+
+    // Parse names used on command lines ("density", "speed", "vorticity" / "ppm", "y4m", "png")
+    static bool field_from_name(const std::string& name, FrameField& out);
+    static bool format_from_name(const std::string& name, FrameFormat& out);
+    static const char* field_name(FrameField field);
+};
+
+#endif // FRAME_SINK_HPP
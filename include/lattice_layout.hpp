@@ -0,0 +1,62 @@
+#ifndef LATTICE_LAYOUT_HPP
+#define LATTICE_LAYOUT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+
+// Memory ordering of lattice cells
+enum class CellOrdering {
+    RowMajor,   // idx = y * width + x (vertical neighbours are 'width' cells apart)
+    Tiled,      // Block-linear: TILE_SIZE x TILE_SIZE tiles, row-major inside each tile
+    Morton      // Z-order curve (interleaved x/y bits), matches power-of-two tree subdivision
+};
+
+// Maps 2D lattice coordinates to storage indices and caches per-cell neighbour indices.
+// Non-row-major orderings keep D2Q9 neighbours close in memory, so both the streaming
+// kernel and NaryTree leaves (which cover square blocks) touch fewer cache lines.
+class LatticeLayout {
+private:
+    int width;                          // Number of cells in X direction
+    int height;                         // Number of cells in Y direction
+    int num_directions;                 // Entries per cell in the neighbour table
+    CellOrdering ordering;              // Active storage ordering
+    std::vector<int32_t> storage_of;    // Row-major index -> storage index
+    std::vector<int32_t> linear_of;     // Storage index -> row-major index
+    std::vector<int32_t> neighbor_table; // [storage_idx * num_directions + i] -> storage index (-1 = outside grid)
+
+    // Sort key of cell (x, y) for the active ordering
+    uint64_t ordering_key(int x, int y) const;
+
+public:
+    static const int TILE_SIZE = 8;     // Tile edge length for CellOrdering::Tiled
+
+    // Build index tables; cx/cy hold the lattice velocity set (num_dirs entries each)
+    LatticeLayout(int width, int height, CellOrdering ordering,
+                  const int* cx, const int* cy, int num_dirs);
+
+    // Storage index of cell (x, y)
+    int index(int x, int y) const {
+        return ordering == CellOrdering::RowMajor ? y * width + x : storage_of[y * width + x];
+    }
+
+    // Lattice coordinates of a storage index
+    int cell_x(int idx) const {
+        return (ordering == CellOrdering::RowMajor ? idx : linear_of[idx]) % width;
+    }
+    int cell_y(int idx) const {
+        return (ordering == CellOrdering::RowMajor ? idx : linear_of[idx]) / width;
+    }
+
+    // Neighbour storage indices of a cell, one per lattice direction (-1 = outside grid)
+    const int32_t* neighbors(int idx) const {
+        return &neighbor_table[static_cast<size_t>(idx) * num_directions];
+    }
+
+    int get_width() const { return width; }
+    int get_height() const { return height; }
+    int get_cell_count() const { return width * height; }
+    CellOrdering get_ordering() const { return ordering; }
+};
+
+#endif // LATTICE_LAYOUT_HPP
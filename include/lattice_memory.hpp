@@ -0,0 +1,71 @@
+#ifndef LATTICE_MEMORY_HPP
+#define LATTICE_MEMORY_HPP
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Page backing of the large lattice buffers (populations, cells, velocity planes).
+// Huge pages cut TLB misses on grids of many megabytes; blocks below HUGE_PAGE_SIZE and
+// platforms other than Linux always use regular pages.
+enum class HugePageMode {
+    Off,         // Regular pages
+    Transparent, // 2 MiB-aligned mapping advised for transparent huge pages (madvise)
+    HugeTLB      // MAP_HUGETLB pages from the reserved pool (vm.nr_hugepages); Transparent when it is empty
+};
+
+const size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+// "off" | "thp" | "hugetlb"
+bool huge_pages_from_name(const std::string& name, HugePageMode& out);
+const char* huge_pages_name(HugePageMode mode);
+
+// Uninitialized block of 'bytes' (64-byte aligned, throws std::bad_alloc). The pages are
+// only backed on first write, so the writing thread decides their NUMA node.
+// free_lattice_block() must get the same 'bytes' and 'mode'.
+void* allocate_lattice_block(size_t bytes, HugePageMode mode);
+void free_lattice_block(void* block, size_t bytes, HugePageMode mode);
+
+// Allocator of the lattice buffers. resize() default-initializes new elements, so for
+// trivial types it writes nothing and the buffer is first touched by whoever fills it
+// (BasicBLWFluid fills in its thread pool, chunk by chunk).
+template <typename T>
+class LatticeAllocator {
+private:
+    HugePageMode mode;            // Backing of the blocks handed out
+
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    LatticeAllocator(HugePageMode mode = HugePageMode::Off) noexcept : mode(mode) {}
+    template <typename U>
+    LatticeAllocator(const LatticeAllocator<U>& other) noexcept : mode(other.get_mode()) {}
+
+    HugePageMode get_mode() const { return mode; }
+
+    T* allocate(size_t count) { return static_cast<T*>(allocate_lattice_block(count * sizeof(T), mode)); }
+    void deallocate(T* block, size_t count) noexcept { free_lattice_block(block, count * sizeof(T), mode); }
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    bool operator==(const LatticeAllocator<U>& other) const { return mode == other.get_mode(); }
+};
+
+template <typename T>
+using LatticeVector = std::vector<T, LatticeAllocator<T>>;
+
+#endif // LATTICE_MEMORY_HPP
@@ -0,0 +1,61 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <initializer_list>
+
+// Shared by the mapped binary formats (checkpoints, obstacle sets): a header holding
+// BYTE_ORDER_MARK as written, then sections starting at SECTION_ALIGNMENT-byte offsets
+static const uint32_t BYTE_ORDER_MARK = 0x01020304u;
+static const uint64_t SECTION_ALIGNMENT = 64;
+
+inline uint64_t align_section(uint64_t offset) {
+    return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// 64-bit checksum (four interleaved multiply-xor lanes, fast enough to run at memory speed);
+// pass the previous result as 'seed' to chain sections
+uint64_t section_checksum(const uint8_t* data, size_t length, uint64_t seed = 0);
+
+// 'length' bytes from 'data' written at byte 'offset' of a file
+struct FileSection {
+    uint64_t offset;                // Aligned start of the section (0 for the header)
+    const void* data;               // Section payload
+    uint64_t length;                // Payload bytes
+};
+
+// Write 'sections' (in increasing offset order, zero padding in between) to 'filename'.tmp,
+// then rename it over 'filename': processes that mapped the old file keep their pages and
+// new ones see the complete new file. 'module' names the caller in error messages.
+bool write_sections(const std::string& filename, std::initializer_list<FileSection> sections, const char* module);
+
+// Read-only memory mapping of a whole file (closed by the destructor). The pages come
+// from the OS file cache, so every process mapping the same file shares one copy.
+class MappedFile {
+private:
+    const uint8_t* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;           // HANDLE of the open file (null = not open)
+    void* mapping = nullptr;        // HANDLE of the file mapping
+#else
+    int fd = -1;
+#endif
+
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    // Map 'filename'; false if it cannot be opened, is empty or cannot be mapped.
+    // 'sequential' hints that the file is read front to back once (e.g. a restore).
+    bool open(const std::string& filename, bool sequential = false);
+
+    const uint8_t* data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+#endif // MAPPED_FILE_HPP
@@ -4,6 +4,11 @@
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 
 // Custom 2D vector struct for position calculations
 struct Vec2 {
@@ -31,37 +36,143 @@ struct Vec2 {
     }
 };
 
-// Node structure for N-ary tree spatial partitioning
+// One entry of a batched position update (see SpatialIndex::update_batch)
+struct PointMove {
+    size_t id;    // Point/cell index
+    Vec2 pos;     // New position
+};
+
+// Arity-independent interface to NaryTree<N>, so the fan-out can be chosen at runtime
+class SpatialIndex {
+public:
+    virtual ~SpatialIndex() = default;
+
+    // Position of point i; lets a tree be built from implicit coordinates (e.g. grid
+    // cells) without materializing a position array
+    using PointPosition = std::function<Vec2(size_t)>;
+
+    // Build index from 'count' points at position(0) .. position(count - 1) (point i is
+    // stored as cell index i), replacing any previous contents
+    virtual void build(size_t count, const PointPosition& position) = 0;
+
+    // Same, from an explicit list of cell positions
+    void build(const std::vector<Vec2>& cell_positions) {
+        build(cell_positions.size(), [&cell_positions](size_t i) { return cell_positions[i]; });
+    }
+
+    // Query all cells within a rectangular range
+    virtual std::vector<size_t> query_range(const Vec2& min, const Vec2& max) const = 0;
+
+    // Remove all cells, keeping allocated memory for the next build
+    virtual void clear() = 0;
+
+    // Incremental updates: add a point, remove it, or move it to a new position.
+    // insert() of an existing id behaves like relocate(); erase() returns false for unknown ids.
+    virtual void insert(size_t id, const Vec2& pos) = 0;
+    virtual bool erase(size_t id) = 0;
+    virtual void relocate(size_t id, const Vec2& new_pos) = 0;
+
+    // Apply many moves at once; unknown ids are inserted
+    virtual void update_batch(const std::vector<PointMove>& moves) = 0;
+
+    // Number of points currently stored
+    virtual size_t size() const = 0;
+
+    // Tree fan-out per axis (each node has arity x arity children)
+    virtual int arity() const = 0;
+};
+
+// Monotonic arena: hands out contiguous blocks carved from large chunks.
+// reset() rewinds in O(1) and keeps the chunks, so rebuilding a tree reuses the same
+// memory instead of going back to the global allocator. T must be trivially destructible.
+template <typename T>
+class MonotonicArena {
+private:
+    std::vector<std::vector<T>> chunks; // Backing storage (each chunk is sized once)
+    size_t current_chunk;               // Chunk currently being carved
+    size_t used;                        // Elements used in the current chunk
+    size_t chunk_size;                  // Default elements per new chunk
+
+public:
+    explicit MonotonicArena(size_t chunk_elements)
+        : current_chunk(0), used(0), chunk_size(chunk_elements) {}
+
+    // Allocate 'count' contiguous elements (contents are unspecified)
+    T* allocate(size_t count) {
+        while (current_chunk < chunks.size()) {
+            std::vector<T>& chunk = chunks[current_chunk];
+            if (chunk.size() - used >= count) {
+                T* block = chunk.data() + used;
+                used += count;
+                return block;
+            }
+            ++current_chunk;
+            used = 0;
+        }
+        chunks.emplace_back(std::max(chunk_size, count));
+        current_chunk = chunks.size() - 1;
+        used = count;
+        return chunks.back().data();
+    }
+
+    // Forget all allocations; chunks are kept for reuse
+    void reset() {
+        current_chunk = 0;
+        used = 0;
+    }
+
+    // Total elements reserved across all chunks
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto& chunk : chunks) total += chunk.size();
+        return total;
+    }
+};
+
+// Node structure for N-ary tree spatial partitioning.
+// Nodes and their index lists live in the owning tree's arenas: nodes are never
+// deleted individually, the whole tree is released by resetting the arenas.
+// A subdivided node whose subtree empties is merged back into an empty leaf; its
+// child block stays attached so a later split reuses it without allocating.
 template <int N>
 class NaryTreeNode {
 public:
     Vec2 min_bounds;       // Minimum bounds of the node (x1, y1)
     Vec2 max_bounds;       // Maximum bounds of the node (x2, y2)
-    std::vector<size_t> cell_indices; // Indices of fluid cells in this node
-    std::vector<NaryTreeNode<N>*> children; // Child nodes (if subdivided)
+    size_t* cell_indices;  // Indices of fluid cells in this node (arena-owned)
+    uint32_t cell_count;   // Number of entries in cell_indices
+    uint32_t cell_capacity; // Slots available at cell_indices
+    NaryTreeNode<N>* children; // First of N*N contiguous child nodes (arena-owned, if subdivided)
+    NaryTreeNode<N>* parent;   // Parent node (nullptr for the root)
+    uint32_t point_count;  // Cells stored in this node's whole subtree
     bool is_leaf;          // Flag indicating if node is a leaf (no children)
     
-    // Constructor: Initialize node with bounds
-    NaryTreeNode(const Vec2& min, const Vec2& max) 
-        : min_bounds(min), max_bounds(max), is_leaf(true) {}
+    NaryTreeNode() : NaryTreeNode(Vec2(), Vec2(), nullptr) {}
     
-    // Destructor: Recursively delete child nodes to avoid memory leaks
-    ~NaryTreeNode() {
-        for (auto child : children) {
-            delete child;
-        }
-    }
+    // Constructor: Initialize node with bounds
+    NaryTreeNode(const Vec2& min, const Vec2& max, NaryTreeNode<N>* parent_node) 
+        : min_bounds(min), max_bounds(max), cell_indices(nullptr), cell_count(0),
+          cell_capacity(0), children(nullptr), parent(parent_node), point_count(0), is_leaf(true) {}
 };
 
 // N-ary tree class for efficient neighbor queries
 template <int N>
-class NaryTree {
+class NaryTree : public SpatialIndex {
 private:
-    NaryTreeNode<N>* root;          // Root node of the tree（修复：先声明 root）
-    float cell_size_threshold;      // Threshold to stop subdividing nodes（后声明 threshold）
+    NaryTreeNode<N>* root;          // Root node of the tree
+    Vec2 world_min;                 // World bounds (root is recreated from these on clear())
+    Vec2 world_max;
+    float cell_size_threshold;      // Threshold to stop subdividing nodes
     const float MIN_NODE_SIZE = 4.0f; // Minimum node size (prevents infinite subdivision)
     
-    // Recursively subdivide a node into NxN child nodes
+    MonotonicArena<NaryTreeNode<N>> node_arena; // Storage for all nodes
+    MonotonicArena<size_t> index_arena;         // Storage for all leaf index lists
+    std::vector<NaryTreeNode<N>*> leaf_of;      // Leaf holding each id (nullptr = not stored)
+    std::vector<uint32_t> slot_of;              // Position of each id inside its leaf's index list
+    std::vector<NaryTreeNode<N>*> emptied;      // Nodes whose subtree emptied during a batch
+    size_t stored_points;                       // Number of ids currently stored
+    
+    // Subdivide a node into NxN child nodes (allocated as one contiguous block)
     void subdivide(NaryTreeNode<N>* node) {
         if (!node->is_leaf) return;
         
@@ -74,7 +185,14 @@ private:
             return;
         }
         
-        // Create NxN child nodes
+        // Split of a previously merged node: reactivate its retained (empty) children
+        if (node->children) {
+            node->is_leaf = false;
+            return;
+        }
+        
+        // Create NxN child nodes (child i * N + j covers column i, row j)
+        NaryTreeNode<N>* children = node_arena.allocate(N * N);
         for (int i = 0; i < N; ++i) {
             for (int j = 0; j < N; ++j) {
                 Vec2 child_min(
@@ -85,89 +203,270 @@ private:
                     node->min_bounds.x + (i + 1) * dx,
                     node->min_bounds.y + (j + 1) * dy
                 );
-                node->children.push_back(new NaryTreeNode<N>(child_min, child_max));
+                children[i * N + j] = NaryTreeNode<N>(child_min, child_max, node);
             }
         }
         
+        node->children = children;
         node->is_leaf = false;
     }
     
-    // Recursively insert a cell into the appropriate node
-    bool insert_cell(NaryTreeNode<N>* node, const Vec2& cell_pos, size_t cell_idx) {
-        // Check if cell is outside current node bounds
+    // Child of an internal node containing 'pos'. Bounds are inclusive, so a point on a
+    // shared edge belongs to the lower column/row, as with a first-match scan.
+    NaryTreeNode<N>* child_containing(const NaryTreeNode<N>* node, const Vec2& pos) const {
+        const NaryTreeNode<N>* c = node->children;
+        float dx = (node->max_bounds.x - node->min_bounds.x) / N;
+        float dy = (node->max_bounds.y - node->min_bounds.y) / N;
+        
+        int i = std::clamp(static_cast<int>((pos.x - node->min_bounds.x) / dx), 0, N - 1);
+        while (i > 0 && pos.x <= c[(i - 1) * N].max_bounds.x) --i;
+        while (i < N - 1 && pos.x > c[i * N].max_bounds.x) ++i;
+        
+        int j = std::clamp(static_cast<int>((pos.y - node->min_bounds.y) / dy), 0, N - 1);
+        while (j > 0 && pos.y <= c[j - 1].max_bounds.y) --j;
+        while (j < N - 1 && pos.y > c[j].max_bounds.y) ++j;
+        
+        return node->children + (i * N + j);
+    }
+    
+    // Find (creating subdivisions as needed) the leaf that stores a cell at 'cell_pos'
+    NaryTreeNode<N>* find_leaf(const Vec2& cell_pos) {
+        NaryTreeNode<N>* node = root;
+        
+        // Check if cell is outside the tree bounds
         if (cell_pos.x < node->min_bounds.x || cell_pos.x > node->max_bounds.x ||
             cell_pos.y < node->min_bounds.y || cell_pos.y > node->max_bounds.y) {
-            return false;
+            return nullptr;
         }
         
-        // If leaf node: add cell or subdivide
-        if (node->is_leaf) {
-            float node_width = node->max_bounds.x - node->min_bounds.x;
-            float node_height = node->max_bounds.y - node->min_bounds.y;
-            
-            // Add cell to leaf if below threshold, else subdivide
-            if (node_width <= cell_size_threshold && node_height <= cell_size_threshold) {
-                node->cell_indices.push_back(cell_idx);
-                return true;
-            } else {
+        while (true) {
+            if (node->is_leaf) {
+                float node_width = node->max_bounds.x - node->min_bounds.x;
+                float node_height = node->max_bounds.y - node->min_bounds.y;
+                
+                // Store in leaf if below threshold, else subdivide
+                if (node_width <= cell_size_threshold && node_height <= cell_size_threshold) {
+                    return node;
+                }
                 subdivide(node);
+                
+                // Subdivision refused (children would fall below MIN_NODE_SIZE): keep cell here
+                if (node->is_leaf) {
+                    return node;
+                }
             }
+            node = child_containing(node, cell_pos);
         }
-        
-        // Insert into child nodes (recursive)
-        for (auto child : node->children) {
-            if (insert_cell(child, cell_pos, cell_idx)) {
-                return true;
+    }
+    
+    // Append 'id' to a leaf's index list, growing it from the arena when full
+    void attach(size_t id, NaryTreeNode<N>* leaf) {
+        if (leaf->cell_count == leaf->cell_capacity) {
+            uint32_t new_capacity = std::max<uint32_t>(4, leaf->cell_capacity * 2);
+            size_t* block = index_arena.allocate(new_capacity);
+            std::copy(leaf->cell_indices, leaf->cell_indices + leaf->cell_count, block);
+            leaf->cell_indices = block; // Old block is reclaimed by the next clear()
+            leaf->cell_capacity = new_capacity;
+        }
+        if (id >= leaf_of.size()) {
+            leaf_of.resize(id + 1, nullptr);
+            slot_of.resize(id + 1, 0);
+        }
+        slot_of[id] = leaf->cell_count;
+        leaf->cell_indices[leaf->cell_count++] = id;
+        leaf_of[id] = leaf;
+        stored_points++;
+        for (NaryTreeNode<N>* n = leaf; n; n = n->parent) {
+            n->point_count++;
+        }
+    }
+    
+    // Remove 'id' from its leaf (swap with the last entry); emptied ancestors are
+    // recorded in 'emptied' for merge_emptied()
+    void detach(size_t id) {
+        NaryTreeNode<N>* leaf = leaf_of[id];
+        uint32_t slot = slot_of[id];
+        size_t last = leaf->cell_indices[--leaf->cell_count];
+        leaf->cell_indices[slot] = last;
+        slot_of[last] = slot;
+        leaf_of[id] = nullptr;
+        stored_points--;
+        for (NaryTreeNode<N>* n = leaf; n; n = n->parent) {
+            if (--n->point_count == 0 && !n->is_leaf) {
+                emptied.push_back(n);
             }
         }
-        
-        return false;
+    }
+    
+    // Merge subdivided nodes that are still empty back into leaves
+    void merge_emptied() {
+        for (NaryTreeNode<N>* n : emptied) {
+            if (n->point_count == 0) {
+                n->is_leaf = true;
+            }
+        }
+        emptied.clear();
+    }
+    
+    // Leaf for a new position; throws if it lies outside the tree bounds
+    NaryTreeNode<N>* leaf_for(const Vec2& pos) {
+        NaryTreeNode<N>* leaf = find_leaf(pos);
+        if (!leaf) {
+            throw std::out_of_range("Point outside tree bounds");
+        }
+        return leaf;
+    }
+    
+    // Whether 'pos' still falls inside the bounds of 'leaf'
+    static bool leaf_contains(const NaryTreeNode<N>* leaf, const Vec2& pos) {
+        return pos.x >= leaf->min_bounds.x && pos.x <= leaf->max_bounds.x &&
+               pos.y >= leaf->min_bounds.y && pos.y <= leaf->max_bounds.y;
     }
 
 public:
-    // 修复：初始化顺序与声明顺序一致（root 后于 cell_size_threshold）
     NaryTree(const Vec2& world_min, const Vec2& world_max, float threshold) 
-        : cell_size_threshold(threshold), root(nullptr) {
+        : root(nullptr), world_min(world_min), world_max(world_max), cell_size_threshold(threshold),
+          node_arena(4096), index_arena(65536), stored_points(0) {
         // Validate world bounds
         if (world_min.x >= world_max.x || world_min.y >= world_max.y) {
             throw std::invalid_argument("Invalid world bounds: min >= max");
         }
-        root = new NaryTreeNode<N>(world_min, world_max);
+        clear();
     }
     
-    // Destructor: Delete root node (recursively cleans up children)
-    ~NaryTree() {
-        delete root;
+    // Nodes point into the arenas: copying would alias them
+    NaryTree(const NaryTree&) = delete;
+    NaryTree& operator=(const NaryTree&) = delete;
+    
+    // Drop all nodes and indices in O(1); arena memory is kept for the next build
+    void clear() override {
+        node_arena.reset();
+        index_arena.reset();
+        root = node_arena.allocate(1);
+        *root = NaryTreeNode<N>(world_min, world_max, nullptr);
+        leaf_of.clear();
+        slot_of.clear();
+        emptied.clear();
+        stored_points = 0;
     }
     
-    // Build tree from list of cell positions
-    void build(const std::vector<Vec2>& cell_positions) {
-        if (!root) {
-            throw std::runtime_error("Tree root not initialized");
-        }
+    using SpatialIndex::build;
+    
+    // Build tree from 'count' cell positions, replacing any previous contents
+    void build(size_t count, const PointPosition& position) override {
+        clear();
         
-        // Insert each cell into the tree
-        for (size_t i = 0; i < cell_positions.size(); ++i) {
-            if (!insert_cell(root, cell_positions[i], i)) {
+        // Pass 1: locate each cell's leaf and count cells per leaf and per subtree
+        leaf_of.resize(count);
+        slot_of.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            NaryTreeNode<N>* leaf = find_leaf(position(i));
+            if (!leaf) {
                 throw std::runtime_error("Failed to insert cell into tree");
             }
+            leaf->cell_count++;
+            leaf_of[i] = leaf;
+            for (NaryTreeNode<N>* n = leaf->parent; n; n = n->parent) {
+                n->point_count++;
+            }
+        }
+        
+        // Pass 2: give each leaf an exactly sized index block on first visit, then fill it
+        for (size_t i = 0; i < count; ++i) {
+            NaryTreeNode<N>* leaf = leaf_of[i];
+            if (!leaf->cell_indices) {
+                leaf->cell_capacity = leaf->cell_count;
+                leaf->point_count = leaf->cell_count;
+                leaf->cell_indices = index_arena.allocate(leaf->cell_capacity);
+                leaf->cell_count = 0;
+            }
+            slot_of[i] = leaf->cell_count;
+            leaf->cell_indices[leaf->cell_count++] = i;
         }
+        stored_points = count;
+    }
+    
+    // Same as build(); named for call sites that refresh an existing tree
+    void rebuild(const std::vector<Vec2>& cell_positions) {
+        build(cell_positions);
+    }
+    
+    void insert(size_t id, const Vec2& pos) override {
+        if (contains(id)) {
+            relocate(id, pos);
+            return;
+        }
+        attach(id, leaf_for(pos));
+    }
+    
+    bool erase(size_t id) override {
+        if (!contains(id)) return false;
+        detach(id);
+        merge_emptied();
+        return true;
+    }
+    
+    void relocate(size_t id, const Vec2& new_pos) override {
+        if (!contains(id)) {
+            attach(id, leaf_for(new_pos));
+            return;
+        }
+        if (leaf_contains(leaf_of[id], new_pos)) return; // Still in the same leaf
+        NaryTreeNode<N>* leaf = leaf_for(new_pos);
+        detach(id);
+        attach(id, leaf);
+        merge_emptied();
+    }
+    
+    // Points that stay inside their leaf cost one bounds test. The others are detached
+    // first and re-attached afterwards, so nodes emptied and refilled within the same
+    // batch are not merged and re-split; merging happens once at the end.
+    void update_batch(const std::vector<PointMove>& moves) override {
+        for (const PointMove& m : moves) { // Validate first so a bad entry leaves the tree untouched
+            if (!leaf_contains(root, m.pos)) {
+                throw std::out_of_range("Point outside tree bounds");
+            }
+        }
+        
+        std::vector<const PointMove*> movers;
+        for (const PointMove& m : moves) {
+            if (contains(m.id)) {
+                if (leaf_contains(leaf_of[m.id], m.pos)) continue;
+                detach(m.id);
+            }
+            movers.push_back(&m);
+        }
+        for (const PointMove* m : movers) {
+            if (!contains(m->id)) { // Guard against duplicate ids in one batch
+                attach(m->id, leaf_for(m->pos));
+            } else {
+                relocate(m->id, m->pos);
+            }
+        }
+        merge_emptied();
+    }
+    
+    size_t size() const override { return stored_points; }
+    
+    bool contains(size_t id) const {
+        return id < leaf_of.size() && leaf_of[id] != nullptr;
     }
     
     // Query all cells within a rectangular range
-    std::vector<size_t> query_range(const Vec2& min, const Vec2& max) const {
+    std::vector<size_t> query_range(const Vec2& min, const Vec2& max) const override {
         std::vector<size_t> result;
         if (!root) return result;
         
-        std::vector<NaryTreeNode<N>*> stack;
+        std::vector<const NaryTreeNode<N>*> stack;
         stack.push_back(root);
         
         // Iterative DFS to avoid stack overflow with deep trees
         while (!stack.empty()) {
-            NaryTreeNode<N>* node = stack.back();
+            const NaryTreeNode<N>* node = stack.back();
             stack.pop_back();
             
-            // Skip nodes that don't overlap with query range
+            // Skip empty subtrees and nodes that don't overlap with query range
+            if (node->point_count == 0) continue;
             if (node->max_bounds.x < min.x || node->min_bounds.x > max.x ||
                 node->max_bounds.y < min.y || node->min_bounds.y > max.y) {
                 continue;
@@ -175,17 +474,51 @@ public:
             
             // Add cells from leaf nodes
             if (node->is_leaf) {
-                result.insert(result.end(), node->cell_indices.begin(), node->cell_indices.end());
+                result.insert(result.end(), node->cell_indices, node->cell_indices + node->cell_count);
             } else {
                 // Add child nodes to stack for further checking
-                for (auto child : node->children) {
-                    stack.push_back(child);
+                for (int c = 0; c < N * N; ++c) {
+                    stack.push_back(node->children + c);
                 }
             }
         }
         
         return result;
     }
+    
+    int arity() const override { return N; }
+    
+    // Bytes reserved by the node and index arenas
+    size_t arena_bytes() const {
+        return node_arena.capacity() * sizeof(NaryTreeNode<N>) + index_arena.capacity() * sizeof(size_t);
+    }
 };
 
+// Arities compiled into the library (explicitly instantiated in src/fluid/nary_tree.cpp)
+const int SUPPORTED_TREE_ARITIES[] = {2, 4, 8, 16};
+
+extern template class NaryTree<2>;
+extern template class NaryTree<4>;
+extern template class NaryTree<8>;
+extern template class NaryTree<16>;
+
+// Create a tree with the given arity (must be one of SUPPORTED_TREE_ARITIES)
+std::unique_ptr<SpatialIndex> make_spatial_index(int arity, const Vec2& world_min,
+                                                 const Vec2& world_max, float threshold);
+
+// Build and query cost of one arity, measured by select_fastest_arity()
+struct ArityBenchmark {
+    int arity;
+    double build_ms;   // Best-of-N time for build()
+    double query_ms;   // Best-of-N time for the whole query set
+};
+
+// Time build() + query_range() for every supported arity on the given points and
+// query boxes; returns the arity with the lowest total cost. Per-arity results are
+// appended to 'report' when it is non-null.
+int select_fastest_arity(const Vec2& world_min, const Vec2& world_max, float threshold,
+                         size_t count, const SpatialIndex::PointPosition& position,
+                         const std::vector<std::pair<Vec2, Vec2>>& queries,
+                         std::vector<ArityBenchmark>* report = nullptr);
+
 #endif // NARY_TREE_HPP
\ No newline at end of file
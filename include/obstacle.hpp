@@ -6,6 +6,12 @@
 #include <iostream>
 #include <nary_tree.hpp> // For Vec2 definition
 
+// Run of cells [begin, end) along one grid row
+struct CellSpan {
+    int begin;
+    int end;
+};
+
 // Polygon obstacle structure (declarations only)
 struct PolygonObstacle {
     std::vector<Vec2> vertices; // Vertices (clockwise order)
@@ -18,6 +24,11 @@ struct PolygonObstacle {
 
     // Point-in-polygon check
     bool point_inside(const Vec2& p) const;
+
+    // Append the cells of one grid row that lie inside the polygon: cell x is at
+    // (x * cell_size, y), x in [0, width). Same result as point_inside() per cell, but the
+    // edges are intersected once per row instead of once per cell.
+    void row_spans(float y, float cell_size, int width, std::vector<CellSpan>& spans) const;
 };
 
 // Obstacle manager class (declarations only)
@@ -37,8 +48,18 @@ public:
     // Check if point is obstructed
     bool is_point_obstructed(const Vec2& p) const;
 
+    // Spans of obstructed cells on one grid row (see PolygonObstacle::row_spans; spans of
+    // different polygons may overlap)
+    void row_spans(float y, float cell_size, int width, std::vector<CellSpan>& spans) const;
+
     // Get obstacle count
     size_t get_obstacle_count() const;
+
+    // All loaded polygons (closed: last vertex repeats the first)
+    const std::vector<PolygonObstacle>& get_obstacles() const { return obstacles; }
+
+    // Remove all obstacles
+    void clear() { obstacles.clear(); }
 };
 
 #endif // OBSTACLE_HPP
\ No newline at end of file
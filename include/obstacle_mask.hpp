@@ -0,0 +1,139 @@
+#ifndef OBSTACLE_MASK_HPP
+#define OBSTACLE_MASK_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <bit>
+#include <algorithm>
+#include <memory>
+
+class ObstacleManager;
+class LatticeLayout;
+
+// One bit per cell (1 = obstacle), 64 cells per word. Bit b of word w is cell w * 64 + b,
+// so a word covers 64 consecutive cells of whatever order the owner indexes by (storage
+// order in BasicBLWFluid, row-major in FieldSnapshot). Bits past size() stay zero, which
+// keeps word-level tests valid for the last, partial word.
+// A mask can also be a read-only view of words owned elsewhere (see view(), e.g. a mapped
+// ObstacleSet file); copies of a view share those words, and the first modification copies
+// them into the mask's own storage.
+class ObstacleMask {
+public:
+    static const size_t WORD_BITS = 64;
+
+private:
+    std::vector<uint64_t> bits;   // Packed mask, (size() + 63) / 64 words (empty for a view)
+    const uint64_t* data;         // bits.data(), or the viewed words
+    std::shared_ptr<const void> owner; // Keeps viewed words alive (null when 'bits' is used)
+    size_t cell_count;            // Cells covered
+
+    // Copy viewed words into 'bits' before a modification
+    void make_owned();
+
+public:
+    ObstacleMask() : data(nullptr), cell_count(0) {}
+    explicit ObstacleMask(size_t count)
+        : bits((count + WORD_BITS - 1) / WORD_BITS, 0), data(bits.data()), cell_count(count) {}
+    ObstacleMask(const ObstacleMask& other)
+        : bits(other.bits), data(other.owner ? other.data : bits.data()), owner(other.owner),
+          cell_count(other.cell_count) {}
+    ObstacleMask(ObstacleMask&& other) noexcept : ObstacleMask() { swap(other); }
+    ObstacleMask& operator=(ObstacleMask other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    void swap(ObstacleMask& other) noexcept {
+        bits.swap(other.bits); // Buffers move with their vectors, so 'data' stays valid
+        std::swap(data, other.data);
+        owner.swap(other.owner);
+        std::swap(cell_count, other.cell_count);
+    }
+
+    // Read-only view of 'count' cells stored in 'words' ((count + 63) / 64 words, bits past
+    // 'count' zero); 'owner' keeps the words alive for as long as any copy of the view exists
+    static ObstacleMask view(const uint64_t* words, size_t count, std::shared_ptr<const void> owner);
+
+    // Resize to 'count' cells, all fluid
+    void resize(size_t count);
+
+    // Mark every cell as fluid
+    void clear();
+
+    size_t size() const { return cell_count; }
+    size_t word_count() const { return (cell_count + WORD_BITS - 1) / WORD_BITS; }
+    const uint64_t* words() const { return data; }
+    uint64_t word(size_t w) const { return data[w]; }
+    bool is_view() const { return owner != nullptr; }
+
+    bool test(size_t idx) const { return (data[idx / WORD_BITS] >> (idx % WORD_BITS)) & 1u; }
+    void set(size_t idx) {
+        if (owner) make_owned();
+        bits[idx / WORD_BITS] |= uint64_t(1) << (idx % WORD_BITS);
+    }
+    void reset(size_t idx) {
+        if (owner) make_owned();
+        bits[idx / WORD_BITS] &= ~(uint64_t(1) << (idx % WORD_BITS));
+    }
+
+    // Mark cells [begin, end) as obstacles, whole words at a time
+    void set_span(size_t begin, size_t end);
+
+    // Obstacle cells in total / in [begin, end) (popcount per word)
+    size_t count() const;
+    size_t count(size_t begin, size_t end) const;
+
+    // True when no cell in [begin, end) is an obstacle
+    bool none(size_t begin, size_t end) const { return count(begin, end) == 0; }
+
+    // Call fn(idx) for each fluid (clear) / obstacle (set) cell in [begin, end), ascending.
+    // All-fluid and all-obstacle words cost one compare.
+    template <typename Fn>
+    void for_each_fluid(size_t begin, size_t end, Fn&& fn) const {
+        visit<false>(begin, end, fn);
+    }
+    template <typename Fn>
+    void for_each_obstacle(size_t begin, size_t end, Fn&& fn) const {
+        visit<true>(begin, end, fn);
+    }
+
+    bool operator==(const ObstacleMask& other) const {
+        return cell_count == other.cell_count && std::equal(data, data + word_count(), other.data);
+    }
+
+private:
+    template <bool Obstacles, typename Fn>
+    void visit(size_t begin, size_t end, Fn& fn) const {
+        size_t idx = begin;
+        while (idx < end) {
+            const size_t w = idx / WORD_BITS;
+            const size_t word_end = std::min(end, (w + 1) * WORD_BITS);
+            uint64_t selected = Obstacles ? data[w] : ~data[w];
+            selected >>= idx % WORD_BITS; // Drop cells before 'idx'
+            if (selected == 0) {
+                idx = word_end;
+                continue;
+            }
+            if (~selected == 0) {
+                for (; idx < word_end; ++idx) fn(idx); // Whole word selected
+                continue;
+            }
+            while (selected != 0) {
+                const size_t cell = idx + static_cast<size_t>(std::countr_zero(selected));
+                if (cell >= word_end) break;
+                fn(cell);
+                selected &= selected - 1;
+            }
+            idx = word_end;
+        }
+    }
+};
+
+// Rasterize all obstacles of 'manager' into 'mask' (indexed by layout storage index; cell
+// (x, y) sits at (x, y) * cell_size). Edges are intersected once per row and the resulting
+// spans are set a word at a time when rows are contiguous (row-major layout).
+void rasterize_obstacles(const ObstacleManager& manager, const LatticeLayout& layout, float cell_size,
+                         ObstacleMask& mask);
+
+#endif // OBSTACLE_MASK_HPP
@@ -0,0 +1,56 @@
+#ifndef OBSTACLE_SET_HPP
+#define OBSTACLE_SET_HPP
+
+#include <string>
+#include <memory>
+#include <obstacle.hpp>
+#include <obstacle_mask.hpp>
+#include <lattice_layout.hpp>
+
+// Obstacle polygons together with their rasterization for one lattice (grid size, cell
+// size and cell ordering). A set never changes after construction and is handed around as
+// a SharedObstacleSet, so any number of solvers on the same geometry hold one copy of the
+// polygons and the mask. A solver that adds an obstacle builds a new set for itself.
+// save() writes the set to a file that load() maps read-only: the mask is then read in
+// place, and all processes that map the same file share its pages.
+class ObstacleSet {
+private:
+    ObstacleManager geometry;     // Polygons
+    ObstacleMask mask;            // Rasterized polygons, layout storage order
+    int grid_width;               // Lattice the mask belongs to
+    int grid_height;
+    CellOrdering ordering;
+    float cell_size;
+
+    ObstacleSet(ObstacleManager geometry, ObstacleMask mask, int width, int height, CellOrdering ordering,
+                float cell_size);
+
+public:
+    // Rasterize 'geometry' for 'layout' (cell (x, y) at (x, y) * cell_size)
+    ObstacleSet(ObstacleManager geometry, const LatticeLayout& layout, float cell_size);
+
+    // Adopt a mask rasterized elsewhere (e.g. a checkpoint); its size must match 'layout'
+    ObstacleSet(ObstacleManager geometry, ObstacleMask mask, const LatticeLayout& layout, float cell_size);
+
+    // Write the set to 'filename' (via a temporary file, like checkpoints); false on I/O error
+    bool save(const std::string& filename) const;
+
+    // Map a file written by save(); null (with a message) if it is missing or invalid
+    static std::shared_ptr<const ObstacleSet> load(const std::string& filename);
+
+    // True when the mask was rasterized for this lattice and cell size
+    bool matches(const LatticeLayout& layout, float cell_size) const;
+
+    const ObstacleManager& get_geometry() const { return geometry; }
+    const ObstacleMask& get_mask() const { return mask; }
+    size_t get_obstacle_count() const { return geometry.get_obstacle_count(); }
+    int get_grid_width() const { return grid_width; }
+    int get_grid_height() const { return grid_height; }
+    CellOrdering get_ordering() const { return ordering; }
+    float get_cell_size() const { return cell_size; }
+    bool is_mapped() const { return mask.is_view(); } // Mask read from a mapped file
+};
+
+using SharedObstacleSet = std::shared_ptr<const ObstacleSet>;
+
+#endif // OBSTACLE_SET_HPP
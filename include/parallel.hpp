@@ -0,0 +1,87 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <string>
+
+// How a ThreadPool hands out chunks and where its threads run
+enum class ThreadPlacement {
+    Dynamic, // Threads claim the next free chunk (best load balance)
+    Static,  // Thread t always runs the same contiguous block of chunks (its row band)
+    Pinned   // Static, and every thread is bound to its own CPU; the caller only waits
+};
+
+// Fixed set of worker threads that split index ranges into chunks. The calling thread
+// works too (except with ThreadPlacement::Pinned), so a pool of size 1 has no workers
+// and runs everything inline.
+// Chunk boundaries depend only on 'count' and 'grain', never on the number of threads:
+// per-chunk results (see pairwise_sum) are therefore identical for any pool size.
+// With a static placement, thread t of n runs chunks [t * chunks / n, (t + 1) * chunks / n)
+// of every job. Memory first touched inside a chunk then stays local to the thread that
+// keeps working on it, which matters on NUMA machines (see BasicBLWFluid::set_thread_count).
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;   // Helper threads (size() - 1, or size() when pinned)
+    ThreadPlacement placement;          // Chunk assignment and CPU binding
+    int thread_count;                   // Threads running chunks (see size())
+    std::mutex mutex;                   // Guards the job description below
+    std::condition_variable work_ready; // Signalled when a new job is published
+    std::condition_variable work_done;  // Signalled when the last worker leaves a job
+    const std::function<void(size_t, size_t)>* job; // Current job (valid while 'busy' > 0)
+    size_t job_count;                   // Indices in the current job
+    size_t job_grain;                   // Indices per chunk
+    size_t job_chunks;                  // Chunks in the current job
+    std::atomic<size_t> next_chunk;     // Next chunk to claim
+    unsigned long generation;           // Incremented per job, wakes the workers
+    int busy;                           // Workers still inside the current job
+    bool stopping;                      // Set by the destructor
+
+    void worker_loop(int index);
+    void run_chunks(int index);
+
+public:
+    // threads <= 0 uses every hardware thread
+    explicit ThreadPool(int threads = 1, ThreadPlacement placement = ThreadPlacement::Dynamic);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads running parallel_for chunks (workers, plus the caller unless pinned)
+    int size() const { return thread_count; }
+    ThreadPlacement get_placement() const { return placement; }
+
+    // Number of chunks parallel_for(count, grain, ...) creates; chunk c covers
+    // [c * grain, min(count, (c + 1) * grain))
+    static size_t chunk_count(size_t count, size_t grain) { return (count + grain - 1) / grain; }
+
+    // Call fn(begin, end) for every chunk of [0, count) and wait for all of them.
+    // Chunks run concurrently, so fn must only write data owned by its range.
+    void parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+};
+
+// "dynamic" | "static" | "pinned"
+bool placement_from_name(const std::string& name, ThreadPlacement& out);
+const char* placement_name(ThreadPlacement placement);
+
+// Sum of values[0..count) by recursive halving. Rounding error grows with log(count)
+// instead of count, and the result depends only on the order of 'values'.
+template <typename T>
+T pairwise_sum(const T* values, size_t count) {
+    if (count == 0) return T(0);
+    if (count <= 8) {
+        T sum = values[0];
+        for (size_t i = 1; i < count; ++i) sum += values[i];
+        return sum;
+    }
+    size_t half = count / 2;
+    return pairwise_sum(values, half) + pairwise_sum(values + half, count - half);
+}
+
+#endif // PARALLEL_HPP
@@ -0,0 +1,151 @@
+#ifndef POPULATION_STORAGE_HPP
+#define POPULATION_STORAGE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+// Storage format of the lattice populations. The kernel computes in the solver's scalar
+// type (float or double); narrower formats are converted on load/store and cut the bytes
+// streamed per cell.
+enum class PopulationPrecision {
+    FP64,   // double, stored as is
+    FP32,   // float, stored as is
+    FP16,   // IEEE half (10-bit mantissa, max 65504), stored as deviation from the weight W[i]
+    BF16    // bfloat16 (7-bit mantissa, float range), stored as deviation from the weight W[i]
+};
+
+// IEEE binary16 conversions, round to nearest even (F16C instructions when compiled with -mf16c).
+// The software path gives the same result as F16C for every non-NaN value; NaN payloads differ
+// (float_to_half returns the canonical quiet NaN with the sign kept).
+inline uint16_t float_to_half(float value) {
+#if defined(__F16C__)
+    return static_cast<uint16_t>(_cvtss_sh(value, _MM_FROUND_TO_NEAREST_INT));
+#else
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+
+    uint16_t half;
+    if (bits >= 0x47800000u) {
+        // 65536 and above (or inf / NaN): saturate to inf, keep NaN quiet
+        half = bits > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    } else if (bits < 0x38800000u) {
+        // Subnormal half or zero: let the FPU round the mantissa by adding a magic constant
+        const uint32_t magic_bits = 0x3f000000u; // 0.5f, puts 2^-24 at the last mantissa bit
+        float f, magic;
+        std::memcpy(&f, &bits, sizeof(f));
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        f += magic;
+        std::memcpy(&bits, &f, sizeof(bits));
+        half = static_cast<uint16_t>(bits - magic_bits);
+    } else {
+        // Normal: rebias the exponent and round the 13 dropped bits to nearest even
+        const uint32_t mantissa_odd = (bits >> 13) & 1u;
+        bits += 0xc8000fffu + mantissa_odd; // (15 - 127) << 23, plus rounding bias
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return static_cast<uint16_t>(half | sign);
+#endif
+}
+
+inline float half_to_float(uint16_t half) {
+#if defined(__F16C__)
+    return _cvtsh_ss(half);
+#else
+    uint32_t bits = static_cast<uint32_t>(half & 0x7fffu) << 13;
+    const uint32_t exponent = bits & 0x0f800000u;
+    bits += 0x38000000u; // (127 - 15) << 23
+    if (exponent == 0x0f800000u) {
+        bits += 0x38000000u; // Inf / NaN: exponent all ones
+    } else if (exponent == 0) {
+        // Zero / subnormal: renormalize through the FPU
+        const uint32_t magic_bits = 0x38800000u; // 2^-14
+        float f, magic;
+        bits += 1u << 23;
+        std::memcpy(&f, &bits, sizeof(f));
+        std::memcpy(&magic, &magic_bits, sizeof(magic));
+        f -= magic;
+        std::memcpy(&bits, &f, sizeof(bits));
+    }
+    bits |= static_cast<uint32_t>(half & 0x8000u) << 16;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+#endif
+}
+
+// bfloat16 is the upper half of a float; round to nearest even, keep NaN quiet
+inline uint16_t float_to_bfloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7fffffffu) > 0x7f800000u) return static_cast<uint16_t>((bits >> 16) | 0x0040u);
+    bits += 0x7fffu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+inline float bfloat16_to_float(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+// Population codecs used as kernel template arguments. load() returns the population
+// in the solver's Scalar type, store() converts it back; 'weight' is the lattice weight
+// of the direction. The 16-bit formats keep f - weight: populations stay close to their
+// rest value, so the deviation uses the full mantissa instead of the digits already
+// covered by the weight.
+template <typename Scalar>
+struct Fp64Populations {
+    using Stored = double;
+    static Scalar load(Stored value, Scalar) { return static_cast<Scalar>(value); }
+    static Stored store(Scalar value, Scalar) { return value; }
+};
+
+template <typename Scalar>
+struct Fp32Populations {
+    using Stored = float;
+    static Scalar load(Stored value, Scalar) { return value; }
+    static Stored store(Scalar value, Scalar) { return static_cast<float>(value); }
+};
+
+template <typename Scalar>
+struct Fp16Populations {
+    using Stored = uint16_t;
+    static Scalar load(Stored value, Scalar weight) { return weight + half_to_float(value); }
+    static Stored store(Scalar value, Scalar weight) { return float_to_half(static_cast<float>(value - weight)); }
+};
+
+template <typename Scalar>
+struct Bf16Populations {
+    using Stored = uint16_t;
+    static Scalar load(Stored value, Scalar weight) { return weight + bfloat16_to_float(value); }
+    static Stored store(Scalar value, Scalar weight) { return float_to_bfloat16(static_cast<float>(value - weight)); }
+};
+
+// Bytes per stored population
+inline size_t population_bytes(PopulationPrecision precision) {
+    switch (precision) {
+        case PopulationPrecision::FP64: return sizeof(double);
+        case PopulationPrecision::FP32: return sizeof(float);
+        default:                        return sizeof(uint16_t);
+    }
+}
+
+// Full-precision storage for a solver scalar type (FP32 for float, FP64 for double)
+template <typename Scalar>
+constexpr PopulationPrecision native_precision() {
+    return sizeof(Scalar) == sizeof(double) ? PopulationPrecision::FP64 : PopulationPrecision::FP32;
+}
+
+// "fp64" | "fp32" | "fp16" | "bf16"
+bool precision_from_name(const std::string& name, PopulationPrecision& out);
+const char* precision_name(PopulationPrecision precision);
+
+#endif // POPULATION_STORAGE_HPP
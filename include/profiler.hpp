@@ -0,0 +1,100 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <trace.hpp>
+
+// Phases timed by PhaseProfiler
+enum class ProfilePhase {
+    Collision,  // BGK collision over all cells
+    Streaming,  // Bulk streaming between fluid cells (includes the state copy)
+    Boundary,   // Bounce-back links (grid edges and obstacles)
+    Density,    // Macroscopic density update
+    Tree,       // Spatial tree build and queries
+    Render,     // Renderer frame (runs on the main thread)
+    Count
+};
+
+// Accumulates wall time per phase with std::chrono::steady_clock (via Tracer::now_ns).
+// Phases are timed per step (never per cell), so the overhead is a few clock reads per
+// update(). Counters are atomic: the solver and render threads record into the same profiler.
+class PhaseProfiler {
+public:
+    static const int PHASE_COUNT = static_cast<int>(ProfilePhase::Count);
+
+    // Totals of one report window
+    struct Window {
+        double seconds = 0.0;           // Wall time of the window
+        uint64_t steps = 0;             // Solver steps
+        uint64_t ns[PHASE_COUNT] = {};  // Time per phase
+        uint64_t calls[PHASE_COUNT] = {}; // Timed sections per phase
+    };
+
+    // RAII timer for one phase; also emits a trace span when the Tracer is enabled.
+    // Does nothing while both are disabled.
+    class Scope {
+    private:
+        PhaseProfiler& profiler;
+        ProfilePhase phase;
+        bool timed;             // Profiler enabled at construction
+        bool traced;            // Tracer enabled at construction
+        uint64_t start_ns;      // Tracer clock
+
+    public:
+        Scope(PhaseProfiler& profiler, ProfilePhase phase)
+            : profiler(profiler), phase(phase), timed(profiler.is_enabled()), traced(Tracer::is_enabled()),
+              start_ns(timed || traced ? Tracer::now_ns() : 0) {}
+        ~Scope() {
+            if (!timed && !traced) return;
+            uint64_t duration = Tracer::now_ns() - start_ns;
+            if (timed) profiler.record(phase, duration);
+            if (traced) Tracer::record(phase_name(phase), "phase", start_ns, duration);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    std::atomic<bool> enabled;
+    std::atomic<uint64_t> phase_ns[PHASE_COUNT];    // Time per phase since the last report
+    std::atomic<uint64_t> phase_calls[PHASE_COUNT]; // Timed sections per phase since the last report
+    std::atomic<uint64_t> steps;                    // Solver steps since the last report
+    uint64_t cells_per_step;                        // Lattice updates per step
+    uint64_t bytes_per_cell;                        // Estimated memory traffic per lattice update
+    std::chrono::steady_clock::time_point window_start; // Start of the current report window
+
+public:
+    PhaseProfiler();
+
+    // Problem size used for MLUPS and bandwidth figures
+    void configure(uint64_t cells_per_step, uint64_t bytes_per_cell);
+
+    void set_enabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    bool is_enabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void record(ProfilePhase phase, uint64_t ns) {
+        phase_ns[static_cast<int>(phase)].fetch_add(ns, std::memory_order_relaxed);
+        phase_calls[static_cast<int>(phase)].fetch_add(1, std::memory_order_relaxed);
+    }
+    void add_step() { steps.fetch_add(1, std::memory_order_relaxed); }
+
+    // Restart the report clock and step count (e.g. after setup); phase times are kept
+    void restart_window();
+
+    // Seconds elapsed in the current report window
+    double window_seconds() const;
+
+    // Return the totals of the current window and start a new one
+    Window collect_window();
+
+    // Print MLUPS, effective bandwidth and the per-phase breakdown of the current window,
+    // then start a new window
+    void report(std::ostream& out);
+
+    static const char* phase_name(ProfilePhase phase);
+};
+
+#endif // PROFILER_HPP
@@ -1,11 +1,38 @@
 #ifndef RENDER_HPP
 #define RENDER_HPP
 
+// Pull in glext.h for the buffer object / sync entry point types
+#ifndef GLFW_INCLUDE_GLEXT
+#define GLFW_INCLUDE_GLEXT
+#endif
 #include <GLFW/glfw3.h>
 #include <string>
+#include <vector>
+#include <cstdint>
+#include <snapshot.hpp>
+#include <triple_buffer.hpp>
+#include <colormap.hpp>
 
 // Forward declaration to avoid including heavy headers in this public header
-class BLWFluid;
+template <typename Scalar> class BasicBLWFluid;
+using BLWFluid = BasicBLWFluid<float>;
+
+// OpenGL entry points for pixel buffer uploads. opengl32 on Windows only exports GL 1.1,
+// so these are resolved through glfwGetProcAddress() once a context is current.
+struct PixelBufferFunctions {
+    PFNGLGENBUFFERSPROC GenBuffers = nullptr;
+    PFNGLDELETEBUFFERSPROC DeleteBuffers = nullptr;
+    PFNGLBINDBUFFERPROC BindBuffer = nullptr;
+    PFNGLBUFFERSTORAGEPROC BufferStorage = nullptr;
+    PFNGLMAPBUFFERRANGEPROC MapBufferRange = nullptr;
+    PFNGLUNMAPBUFFERPROC UnmapBuffer = nullptr;
+    PFNGLFENCESYNCPROC FenceSync = nullptr;
+    PFNGLCLIENTWAITSYNCPROC ClientWaitSync = nullptr;
+    PFNGLDELETESYNCPROC DeleteSync = nullptr;
+
+    // Resolve all entry points; returns false if persistent mapping is unavailable
+    bool load(GLFWwindow* window);
+};
 
 // Render class for OpenGL-based visualization (declarations only)
 class Render {
@@ -13,22 +40,54 @@ private:
     GLFWwindow* window;           // GLFW window handle
     int window_width;             // Window width in pixels
     int window_height;            // Window height in pixels
-    BLWFluid& fluid;              // Reference to fluid simulation
+    BLWFluid& fluid;              // Reference to fluid simulation (metadata only: it may be updating on another thread)
+    TripleBuffer<FieldSnapshot>& snapshots; // Field snapshots published by the simulation
     double last_time;             // Time of last FPS update
     int frame_count;              // Frame counter for FPS calculation
     float fps;                    // Current FPS value
+    long last_step;               // Simulation step at last FPS update
+    float sim_rate;               // Simulation steps per second
+
+    // Fluid field texture: colors are computed on the CPU and drawn as one textured quad
+    static const int PBO_REGIONS = 3; // Ring of upload regions in the persistent PBO
+    GLuint fluid_texture;         // RGBA8 texture, one texel per cell
+    int texture_width;            // Current texture size in cells (0 = not allocated)
+    int texture_height;
+    std::vector<uint32_t> rgba_pixels; // CPU staging buffer (used without a persistent PBO)
+    PixelBufferFunctions pbo;     // Runtime-loaded buffer object entry points
+    bool use_persistent_pbo;      // Persistently mapped PBO available
+    GLuint pixel_buffer;          // Pixel unpack buffer holding PBO_REGIONS frames
+    uint8_t* pixel_buffer_ptr;    // Persistent, coherent mapping of pixel_buffer
+    GLsync pixel_fences[PBO_REGIONS]; // Signalled when the GPU has consumed a region
+    int pixel_region;             // Region written next
+    Colormap colormap;            // Density → RGBA lookup table
+    GLuint obstacle_texture;      // Cached obstacle mask (opaque black on transparent)
+    unsigned long obstacle_revision; // Snapshot obstacle revision held by obstacle_texture (0 = none)
+
+    // HUD text: glyphs come from one atlas texture, a string is one vertex array
+    GLuint glyph_atlas;           // 5x7 font atlas (built once)
+    std::string hud_text;         // Text currently laid out in text_vertices
+    std::vector<float> text_vertices; // x, y, u, v per vertex, 4 vertices per glyph
 
     // Internal helpers (definitions in src/fluid/render.cpp)
     void setup_opengl();
     void update_fps();
-    void draw_char(float x, float y, char c, float scale = 1.0f);
-    void render_fluid();
-    void render_obstacles();
+    void build_glyph_atlas();
+    void layout_text(const std::string& text, float x, float y, float scale = 1.0f);
+    void draw_text();
+    void allocate_fluid_texture(int width, int height);
+    void release_fluid_texture();
+    void upload_fluid_texture(const FieldSnapshot& snapshot);
+    void render_fluid(const FieldSnapshot& snapshot);
+    void update_obstacle_texture(const FieldSnapshot& snapshot);
+    void render_obstacles(const FieldSnapshot& snapshot);
     void render_ui();
 
 public:
-    // Constructor: Initialize GLFW window and rendering context
-    Render(BLWFluid& fluid_ref, int win_width, int win_height, const char* title);
+    // Constructor: Initialize GLFW window and rendering context.
+    // Fields are drawn from the latest snapshot published into 'snapshot_buffer'.
+    Render(BLWFluid& fluid_ref, TripleBuffer<FieldSnapshot>& snapshot_buffer,
+           int win_width, int win_height, const char* title);
 
     // Destructor: Clean up GLFW resources
     ~Render();
@@ -39,7 +98,7 @@ public:
     // Handle user input (ESC to quit)
     void process_input();
 
-    // Main render routine (render obstacles, fluid, UI)
+    // Main render routine: pick up the latest snapshot, render obstacles, fluid, UI
     void render();
 
     // Swap front/back buffers (double buffering)
@@ -48,8 +107,17 @@ public:
     // Poll for events (keyboard, mouse, etc.)
     void poll_events();
 
+    // Wait up to 'timeout' seconds for events (caps the preview rate without busy-looping)
+    void wait_events(double timeout);
+
+    // Select the density color ramp and the value range mapped onto it
+    void set_colormap(Palette palette, float range_min, float range_max);
+
     // Getter for the current FPS value
     float get_current_fps() const;
+
+    // Getter for the simulation rate seen by the renderer (steps per second)
+    float get_sim_rate() const;
 };
 
 #endif // RENDER_HPP
\ No newline at end of file
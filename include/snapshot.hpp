@@ -0,0 +1,23 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <vector>
+#include <cstdint>
+#include <obstacle_mask.hpp>
+
+// Copy of the macroscopic fields published by the simulation for consumers that run
+// concurrently with it (renderer, exporters). All fields are row-major: [y * width + x],
+// independent of the simulation's cell ordering.
+struct FieldSnapshot {
+    int width = 0;                     // Grid cells in X (0 = nothing published yet)
+    int height = 0;                    // Grid cells in Y
+    float cell_size = 0.0f;            // Cell size in world units
+    long step = 0;                     // Simulation step the fields belong to
+    std::vector<float> density;        // Macroscopic density
+    std::vector<float> velocity_x;     // Macroscopic velocity (X)
+    std::vector<float> velocity_y;     // Macroscopic velocity (Y)
+    ObstacleMask obstacle;             // Obstacle cells (row-major bits)
+    unsigned long obstacle_revision = 0; // Solver obstacle revision 'obstacle' was copied from (0 = never)
+};
+
+#endif // SNAPSHOT_HPP
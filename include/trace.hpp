@@ -0,0 +1,75 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// One completed span: [start_ns, start_ns + duration_ns) on the recording thread.
+// 'name' and 'category' must be string literals (only the pointer is stored).
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    uint64_t start_ns;                  // Nanoseconds since the tracer epoch
+    uint64_t duration_ns;
+};
+
+// Process-wide event tracer. Each thread records into its own ring buffer (oldest
+// events are overwritten when it is full), so recording never contends with other
+// threads. write_json() dumps every buffer in Chrome trace format, viewable in
+// chrome://tracing or https://ui.perfetto.dev. Tracing is off until set_enabled(true);
+// while off, TRACE_SCOPE costs one relaxed atomic load.
+class Tracer {
+private:
+    static std::atomic<bool> enabled;
+
+public:
+    static const size_t DEFAULT_CAPACITY = 1 << 16; // Events per thread
+
+    static void set_enabled(bool on) { enabled.store(on, std::memory_order_relaxed); }
+    static bool is_enabled() { return enabled.load(std::memory_order_relaxed); }
+
+    // Ring size for buffers created after this call (threads that have not traced yet)
+    static void set_buffer_capacity(size_t events);
+
+    // Label the calling thread in the trace viewer
+    static void set_thread_name(const char* name);
+
+    // Append a completed span to the calling thread's buffer
+    static void record(const char* name, const char* category, uint64_t start_ns, uint64_t duration_ns);
+
+    // Nanoseconds since the tracer epoch (steady clock)
+    static uint64_t now_ns();
+
+    // Write all buffered events as Chrome trace JSON; returns false on I/O error
+    static bool write_json(const std::string& filename);
+};
+
+// RAII span: records [construction, destruction) when tracing is enabled
+class TraceScope {
+private:
+    const char* name;
+    const char* category;
+    uint64_t start_ns;
+    bool active;
+
+public:
+    TraceScope(const char* name, const char* category)
+        : name(name), category(category), start_ns(0), active(Tracer::is_enabled()) {
+        if (active) start_ns = Tracer::now_ns();
+    }
+    ~TraceScope() {
+        if (active) Tracer::record(name, category, start_ns, Tracer::now_ns() - start_ns);
+    }
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// Trace the enclosing block: TRACE_SCOPE("collision", "solver");
+#define TRACE_SCOPE(name, category) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name, category)
+
+#endif // TRACE_HPP
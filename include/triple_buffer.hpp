@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_HPP
+#define TRIPLE_BUFFER_HPP
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer.
+// The writer fills write_buffer() and publish()es it; the reader calls update() to
+// pick up the most recent published buffer and reads it via read_buffer(). Neither
+// side ever waits for the other: the writer always has a free buffer, and the reader
+// keeps its current buffer until a newer one is available (intermediate ones are dropped).
+template <typename T>
+class TripleBuffer {
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t DIRTY = 0x4;  // Set in 'middle' when it holds an unread buffer
+
+    T buffers[3];
+    std::atomic<uint8_t> middle;       // Buffer exchanged between writer and reader (+ DIRTY flag)
+    uint8_t back;                      // Writer-owned buffer
+    uint8_t front;                     // Reader-owned buffer
+
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer side: buffer to fill next (contents are whatever was last written to it)
+    T& write_buffer() { return buffers[back]; }
+
+    // Writer side: make the filled buffer the latest one
+    void publish() {
+        uint8_t prev = middle.exchange(back | DIRTY, std::memory_order_acq_rel);
+        back = prev & INDEX_MASK;
+    }
+
+    // Reader side: switch to the latest published buffer; returns false if nothing new
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & DIRTY)) return false;
+        uint8_t prev = middle.exchange(front, std::memory_order_acq_rel);
+        front = prev & INDEX_MASK;
+        return true;
+    }
+
+    // Reader side: current buffer (stable until the next update())
+    const T& read_buffer() const { return buffers[front]; }
+};
+
+#endif // TRIPLE_BUFFER_HPP
@@ -0,0 +1,350 @@
+#include <checkpoint.hpp>
+#include <fluid.hpp>
+#include <trace.hpp>
+#include <mapped_file.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+static const char CHECKPOINT_MAGIC[8] = {'B', 'L', 'W', 'C', 'K', 'P', 'T', '\0'};
+CheckpointSections checkpoint_sections(const CheckpointHeader& header) {
+    CheckpointSections s;
+    s.populations = align_section(sizeof(CheckpointHeader));
+    const uint64_t population_size = population_bytes(static_cast<PopulationPrecision>(header.population_precision));
+    s.density = align_section(s.populations + header.cell_count * header.num_velocities * population_size);
+    s.obstacle = align_section(s.density + header.cell_count * header.scalar_size);
+    s.polygon_sizes = align_section(s.obstacle + header.cell_count);
+    s.vertices = align_section(s.polygon_sizes + header.polygon_count * sizeof(uint32_t));
+    s.file_size = s.vertices + header.vertex_count * 2 * sizeof(float);
+    return s;
+}
+
+// Chain the checksum over the header (with 'checksum' zeroed) and every section payload
+// (padding is not included), so corrupt parameters are caught as well as corrupt fields
+static uint64_t file_checksum(const uint8_t* populations, const uint8_t* density, const uint8_t* obstacle,
+                              const uint8_t* polygon_sizes, const uint8_t* vertices, const CheckpointHeader& header) {
+    CheckpointHeader hashed = header;
+    hashed.checksum = 0;
+    uint64_t h = section_checksum(reinterpret_cast<const uint8_t*>(&hashed), sizeof(hashed));
+    const uint64_t population_size = population_bytes(static_cast<PopulationPrecision>(header.population_precision));
+    h = section_checksum(populations, header.cell_count * header.num_velocities * population_size, h);
+    h = section_checksum(density, header.cell_count * header.scalar_size, h);
+    h = section_checksum(obstacle, header.cell_count, h);
+    h = section_checksum(polygon_sizes, header.polygon_count * sizeof(uint32_t), h);
+    h = section_checksum(vertices, header.vertex_count * 2 * sizeof(float), h);
+    return h;
+}
+
+static bool header_valid(const CheckpointHeader& header, const std::string& filename) {
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+        std::cerr << "[ERROR] Checkpoint: Not a checkpoint file - " << filename << std::endl;
+        return false;
+    }
+    if (header.byte_order_mark != BYTE_ORDER_MARK) {
+        std::cerr << "[ERROR] Checkpoint: File written on a host with different byte order - " << filename << std::endl;
+        return false;
+    }
+    if (header.version != CHECKPOINT_VERSION) {
+        std::cerr << "[ERROR] Checkpoint: Unsupported version " << header.version << " - " << filename << std::endl;
+        return false;
+    }
+    if (header.width <= 0 || header.height <= 0 || header.num_velocities != NUM_VELOCITIES ||
+        header.cell_count != static_cast<uint64_t>(header.width) * header.height ||
+        header.ordering < 0 || header.ordering > static_cast<int32_t>(CellOrdering::Morton) ||
+        (header.scalar_size != sizeof(float) && header.scalar_size != sizeof(double)) ||
+        header.population_precision > static_cast<uint32_t>(PopulationPrecision::BF16)) {
+        std::cerr << "[ERROR] Checkpoint: Invalid grid description - " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool write_checkpoint(const CheckpointState& state, const std::string& filename) {
+    TRACE_SCOPE("write checkpoint", "io");
+    CheckpointHeader header = state.header;
+    CheckpointSections sections = checkpoint_sections(header);
+    header.checksum = file_checksum(state.populations.data(), state.density.data(), state.obstacle.data(),
+                                    reinterpret_cast<const uint8_t*>(state.polygon_sizes.data()),
+                                    reinterpret_cast<const uint8_t*>(state.vertices.data()), header);
+
+    return write_sections(filename, {
+        {0, &header, sizeof(header)},
+        {sections.populations, state.populations.data(), state.populations.size()},
+        {sections.density, state.density.data(), state.density.size()},
+        {sections.obstacle, state.obstacle.data(), state.obstacle.size()},
+        {sections.polygon_sizes, state.polygon_sizes.data(), state.polygon_sizes.size() * sizeof(uint32_t)},
+        {sections.vertices, state.vertices.data(), state.vertices.size() * sizeof(float)},
+    }, "Checkpoint");
+}
+
+bool read_checkpoint_header(const std::string& filename, CheckpointHeader& header) {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Checkpoint: Failed to open file - " << filename << std::endl;
+        return false;
+    }
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        std::cerr << "[ERROR] Checkpoint: File too short - " << filename << std::endl;
+        return false;
+    }
+    return header_valid(header, filename);
+}
+
+// Value k of a float or double section, converted to Scalar
+template <typename Scalar>
+static Scalar section_value(const uint8_t* section, size_t k, uint32_t scalar_size) {
+    if (scalar_size == sizeof(double)) return static_cast<Scalar>(reinterpret_cast<const double*>(section)[k]);
+    return static_cast<Scalar>(reinterpret_cast<const float*>(section)[k]);
+}
+
+// Population k of a section saved in 'precision', decoded to Scalar
+template <typename Scalar>
+static Scalar saved_population(const uint8_t* section, size_t k, PopulationPrecision precision, Scalar weight) {
+    const uint16_t* packed = reinterpret_cast<const uint16_t*>(section);
+    switch (precision) {
+        case PopulationPrecision::FP64: return Fp64Populations<Scalar>::load(reinterpret_cast<const double*>(section)[k], weight);
+        case PopulationPrecision::FP16: return Fp16Populations<Scalar>::load(packed[k], weight);
+        case PopulationPrecision::BF16: return Bf16Populations<Scalar>::load(packed[k], weight);
+        default:                        return Fp32Populations<Scalar>::load(reinterpret_cast<const float*>(section)[k], weight);
+    }
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::capture_checkpoint(CheckpointState& state) const {
+    TRACE_SCOPE("capture checkpoint", "io");
+    const size_t count = cells.size();
+
+    CheckpointHeader& header = state.header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    header.version = CHECKPOINT_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.width = grid_width;
+    header.height = grid_height;
+    header.ordering = static_cast<int32_t>(layout.get_ordering());
+    header.num_velocities = NUM_VELOCITIES;
+    header.cell_size = cell_size;
+    header.viscosity = kinematic_viscosity;
+    header.gravity = gravity;
+    header.step_count = step_count;
+    header.scalar_size = sizeof(Scalar);
+    header.population_precision = static_cast<uint32_t>(precision);
+    header.cell_count = count;
+
+    // Cells are copied in storage order: restoring into the same ordering is a straight copy.
+    // Populations are copied in their storage format (no conversion, so no rounding).
+    state.density.resize(count * sizeof(Scalar));
+    state.obstacle.resize(count);
+    with_populations([&state](auto, const auto& f) {
+        state.populations.resize(f.size() * sizeof(f[0]));
+        std::memcpy(state.populations.data(), f.data(), state.populations.size());
+    });
+    Scalar* density_out = reinterpret_cast<Scalar*>(state.density.data());
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+    for (size_t idx = 0; idx < count; ++idx) {
+        density_out[idx] = cells[idx].density;
+        state.obstacle[idx] = obstacles.test(idx) ? 1 : 0;
+    }
+
+    // Obstacle polygons, so a restarted run keeps its obstacle list without re-voxelizing
+    state.polygon_sizes.clear();
+    state.vertices.clear();
+    for (const auto& obstacle : obstacle_set->get_geometry().get_obstacles()) {
+        state.polygon_sizes.push_back(static_cast<uint32_t>(obstacle.vertices.size()));
+        for (const auto& v : obstacle.vertices) {
+            state.vertices.push_back(v.x);
+            state.vertices.push_back(v.y);
+        }
+    }
+    header.polygon_count = state.polygon_sizes.size();
+    header.vertex_count = state.vertices.size() / 2;
+}
+
+template <typename Scalar>
+bool BasicBLWFluid<Scalar>::save_checkpoint(const std::string& filename) const {
+    CheckpointState state;
+    capture_checkpoint(state);
+    return write_checkpoint(state, filename);
+}
+
+template <typename Scalar>
+bool BasicBLWFluid<Scalar>::restore_checkpoint(const std::string& filename) {
+    TRACE_SCOPE("restore checkpoint", "io");
+    MappedFile file;
+    if (!file.open(filename, true)) { // Restore reads front to back
+        std::cerr << "[ERROR] Checkpoint: Failed to map file - " << filename << std::endl;
+        return false;
+    }
+    if (file.size() < sizeof(CheckpointHeader)) {
+        std::cerr << "[ERROR] Checkpoint: File too short - " << filename << std::endl;
+        return false;
+    }
+
+    CheckpointHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (!header_valid(header, filename)) return false;
+
+    CheckpointSections sections = checkpoint_sections(header);
+    if (file.size() < sections.file_size) {
+        std::cerr << "[ERROR] Checkpoint: File truncated - " << filename << std::endl;
+        return false;
+    }
+    if (header.width != grid_width || header.height != grid_height ||
+        static_cast<Scalar>(header.cell_size) != cell_size) {
+        std::cerr << "[ERROR] Checkpoint: Grid " << header.width << "x" << header.height << " (cell size "
+                  << header.cell_size << ") does not match the simulation - " << filename << std::endl;
+        return false;
+    }
+
+    const uint8_t* base = file.data();
+    if (file_checksum(base + sections.populations, base + sections.density, base + sections.obstacle,
+                      base + sections.polygon_sizes, base + sections.vertices, header) != header.checksum) {
+        std::cerr << "[ERROR] Checkpoint: Checksum mismatch (corrupt file) - " << filename << std::endl;
+        return false;
+    }
+
+    // Sections are 64-byte aligned within a page-aligned mapping, so they can be read in place.
+    // A checkpoint of another scalar type or population format is converted while copying.
+    const uint8_t* populations = base + sections.populations;
+    const uint8_t* density = base + sections.density;
+    const uint8_t* obstacle = base + sections.obstacle;
+    const uint32_t* polygon_sizes = reinterpret_cast<const uint32_t*>(base + sections.polygon_sizes);
+    const float* vertices = reinterpret_cast<const float*>(base + sections.vertices);
+
+    // Saved storage index -> our storage index (identity when the orderings match)
+    CellOrdering saved_ordering = static_cast<CellOrdering>(header.ordering);
+    std::vector<int32_t> remap;
+    if (saved_ordering != layout.get_ordering()) {
+        LatticeLayout saved(grid_width, grid_height, saved_ordering, CX, CY, NUM_VELOCITIES);
+        remap.resize(cells.size());
+        for (size_t s = 0; s < cells.size(); ++s) {
+            remap[s] = layout.index(saved.cell_x(static_cast<int>(s)), saved.cell_y(static_cast<int>(s)));
+        }
+    }
+
+    // Populations in our storage format are copied as is; other formats are decoded and re-encoded
+    const PopulationPrecision saved_precision = static_cast<PopulationPrecision>(header.population_precision);
+    const bool same_format = saved_precision == precision;
+    with_populations([&](auto codec, auto& f) {
+        using Codec = decltype(codec);
+        for (size_t s = 0; s < cells.size(); ++s) {
+            const size_t idx = remap.empty() ? s : remap[s];
+            for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                const size_t k = s * NUM_VELOCITIES + i;
+                if (same_format) {
+                    std::memcpy(&f[idx * NUM_VELOCITIES + i], populations + k * sizeof(f[0]), sizeof(f[0]));
+                } else {
+                    const Scalar w = LATTICE_WEIGHTS<Scalar>[i];
+                    f[idx * NUM_VELOCITIES + i] = Codec::store(saved_population<Scalar>(populations, k, saved_precision, w), w);
+                }
+            }
+        }
+    });
+    ObstacleMask obstacles(cells.size());
+    for (size_t s = 0; s < cells.size(); ++s) {
+        const size_t idx = remap.empty() ? s : remap[s];
+        cells[idx].density = section_value<Scalar>(density, s, header.scalar_size);
+        if (obstacle[s] != 0) obstacles.set(idx);
+    }
+
+    // Polygons go straight into a new set: the mask above is already rasterized
+    ObstacleManager obstacle_manager;
+    size_t vertex = 0;
+    for (uint64_t p = 0; p < header.polygon_count; ++p) {
+        std::vector<Vec2> polygon;
+        for (uint32_t k = 0; k < polygon_sizes[p] && vertex < header.vertex_count; ++k, ++vertex) {
+            polygon.emplace_back(vertices[vertex * 2], vertices[vertex * 2 + 1]);
+        }
+        obstacle_manager.add_obstacle_from_vertices(polygon);
+    }
+
+    kinematic_viscosity = static_cast<Scalar>(header.viscosity);
+    gravity = static_cast<Scalar>(header.gravity);
+    step_count = header.step_count;
+    use_obstacle_set(std::make_shared<const ObstacleSet>(std::move(obstacle_manager), std::move(obstacles), layout,
+                                                         static_cast<float>(cell_size)));
+    field_step = -1; // Velocity planes belong to the replaced state
+
+    std::cout << "[DEBUG] Checkpoint: Restored step " << step_count << " from " << filename << std::endl;
+    return true;
+}
+
+template void BasicBLWFluid<float>::capture_checkpoint(CheckpointState&) const;
+template void BasicBLWFluid<double>::capture_checkpoint(CheckpointState&) const;
+template bool BasicBLWFluid<float>::save_checkpoint(const std::string&) const;
+template bool BasicBLWFluid<double>::save_checkpoint(const std::string&) const;
+template bool BasicBLWFluid<float>::restore_checkpoint(const std::string&);
+template bool BasicBLWFluid<double>::restore_checkpoint(const std::string&);
+
+CheckpointWriter::CheckpointWriter()
+    : stopping(false), checkpoints_written(0), checkpoints_failed(0) {
+    writer = std::thread(&CheckpointWriter::writer_loop, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    state_changed.notify_all();
+    writer.join();
+}
+
+template <typename Scalar>
+bool CheckpointWriter::submit(const BasicBLWFluid<Scalar>& fluid, const std::string& filename, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (!pending_file.empty()) {
+        if (!wait) {
+            std::cerr << "[WARNING] Checkpoint: Previous checkpoint still writing, skipping step "
+                      << fluid.get_step_count() << std::endl;
+            return false;
+        }
+        state_changed.wait(lock, [this] { return pending_file.empty(); });
+    }
+
+    // The writer is idle, so 'buffer' is ours until pending_file is set
+    fluid.capture_checkpoint(buffer);
+    pending_file = filename;
+    lock.unlock();
+    state_changed.notify_all();
+    return true;
+}
+
+template bool CheckpointWriter::submit(const BasicBLWFluid<float>&, const std::string&, bool);
+template bool CheckpointWriter::submit(const BasicBLWFluid<double>&, const std::string&, bool);
+
+void CheckpointWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    state_changed.wait(lock, [this] { return pending_file.empty(); });
+}
+
+size_t CheckpointWriter::get_checkpoints_written() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return checkpoints_written;
+}
+
+size_t CheckpointWriter::get_checkpoints_failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return checkpoints_failed;
+}
+
+void CheckpointWriter::writer_loop() {
+    Tracer::set_thread_name("checkpoint writer");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        state_changed.wait(lock, [this] { return stopping || !pending_file.empty(); });
+        if (pending_file.empty()) break; // Stopping with nothing left to write
+
+        std::string filename = pending_file;
+        lock.unlock();
+
+        bool ok = write_checkpoint(buffer, filename);
+
+        lock.lock();
+        if (ok) checkpoints_written++;
+        else checkpoints_failed++;
+        pending_file.clear();
+        state_changed.notify_all();
+    }
+}
@@ -0,0 +1,172 @@
+#include <colormap.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// Channel values in [0, 1] for position t in [0, 1]
+static void palette_color(Palette palette, float t, float& r, float& g, float& b) {
+    switch (palette) {
+        case Palette::Grayscale:
+            r = g = b = t;
+            break;
+        case Palette::Viridis: {
+            // Polynomial fit of matplotlib's viridis
+            const float c[7][3] = {
+                { 0.2777273272f,  0.0054073445f,   0.3340998053f},
+                { 0.1050930431f,  1.4046135299f,   1.3845901626f},
+                {-0.3308618287f,  0.2148475595f,   0.0950951630f},
+                {-4.6342304990f, -5.7991009734f, -19.3324409563f},
+                { 6.2282699363f, 14.1799333668f,  56.6905526007f},
+                { 4.7763849977f,-13.7451453777f, -65.3530326334f},
+                {-5.4354558559f,  4.6458526122f,  26.3124352496f}
+            };
+            float rgb[3];
+            for (int k = 0; k < 3; ++k) {
+                float v = c[6][k];
+                for (int p = 5; p >= 0; --p) v = c[p][k] + t * v;
+                rgb[k] = v;
+            }
+            r = rgb[0]; g = rgb[1]; b = rgb[2];
+            break;
+        }
+        case Palette::CoolWarm: {
+            // Blue (0.23, 0.30, 0.75) → light gray (0.87, 0.87, 0.87) → red (0.71, 0.02, 0.15)
+            if (t < 0.5f) {
+                float s = t * 2.0f;
+                r = 0.23f + (0.87f - 0.23f) * s;
+                g = 0.30f + (0.87f - 0.30f) * s;
+                b = 0.75f + (0.87f - 0.75f) * s;
+            } else {
+                float s = (t - 0.5f) * 2.0f;
+                r = 0.87f + (0.71f - 0.87f) * s;
+                g = 0.87f + (0.02f - 0.87f) * s;
+                b = 0.87f + (0.15f - 0.87f) * s;
+            }
+            break;
+        }
+        case Palette::BlueGreenRed:
+        default:
+            // Same ramp the renderer used over [0.8, 1.2], expressed in t
+            r = std::min(1.0f, t * 2.0f);
+            b = std::min(1.0f, (1.0f - t) * 2.0f);
+            g = 0.2f + 0.6f * (1.0f - std::fabs(t * 2.0f - 1.0f));
+            break;
+    }
+}
+
+static uint32_t to_byte(float v) {
+    return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+Colormap::Colormap(Palette palette, float min, float max)
+    : palette(palette), range_min(0.0f), range_max(1.0f), scale(0.0f), masked_color(0) {
+    set_range(min, max); // Validates the range and builds the LUT
+}
+
+void Colormap::set_palette(Palette new_palette) {
+    palette = new_palette;
+    rebuild_lut();
+}
+
+void Colormap::set_range(float min, float max) {
+    if (!(max > min)) {
+        throw std::invalid_argument("Invalid colormap range: min >= max");
+    }
+    range_min = min;
+    range_max = max;
+    scale = (LUT_SIZE - 1) / (range_max - range_min);
+    rebuild_lut();
+}
+
+void Colormap::rebuild_lut() {
+    for (int k = 0; k < LUT_SIZE; ++k) {
+        float r, g, b;
+        palette_color(palette, static_cast<float>(k) / (LUT_SIZE - 1), r, g, b);
+        lut[k] = pack_rgba(to_byte(r), to_byte(g), to_byte(b));
+    }
+}
+
+uint32_t Colormap::map(float value) const {
+    // Written so that NaN maps to the first entry, matching the SIMD max/min ordering
+    float pos = (value - range_min) * scale;
+    pos = pos > 0.0f ? pos : 0.0f;
+    pos = pos < LUT_SIZE - 1 ? pos : static_cast<float>(LUT_SIZE - 1);
+    return lut[static_cast<int>(pos + 0.5f)];
+}
+
+// Mask bits of values [i, i + n) for n <= 8 with i a multiple of n (never crosses a word)
+static inline uint32_t mask_bits(const uint64_t* mask, size_t i, unsigned n) {
+    return static_cast<uint32_t>(mask[i / 64] >> (i % 64)) & ((1u << n) - 1);
+}
+
+void Colormap::map_field(const float* values, const uint64_t* mask, size_t count, uint32_t* out) const {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    // 8 values per iteration: scale/clamp/round in vector registers, LUT via gather
+    const __m256 v_min = _mm256_set1_ps(range_min);
+    const __m256 v_scale = _mm256_set1_ps(scale);
+    const __m256 v_zero = _mm256_setzero_ps();
+    const __m256 v_top = _mm256_set1_ps(static_cast<float>(LUT_SIZE - 1));
+    const __m256 v_half = _mm256_set1_ps(0.5f);
+    const __m256i v_masked = _mm256_set1_epi32(static_cast<int>(masked_color));
+    const __m256i v_lane_bits = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    for (; i + 8 <= count; i += 8) {
+        __m256 pos = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(values + i), v_min), v_scale);
+        pos = _mm256_min_ps(_mm256_max_ps(pos, v_zero), v_top);
+        __m256i idx = _mm256_cvttps_epi32(_mm256_add_ps(pos, v_half));
+        __m256i rgba = _mm256_i32gather_epi32(reinterpret_cast<const int*>(lut), idx, 4);
+        uint32_t bits = mask ? mask_bits(mask, i, 8) : 0;
+        if (bits) {
+            // Spread the 8 mask bits over the lanes
+            __m256i m32 = _mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), v_lane_bits);
+            m32 = _mm256_cmpeq_epi32(m32, v_lane_bits);
+            rgba = _mm256_blendv_epi8(rgba, v_masked, m32);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), rgba);
+    }
+#elif defined(__SSE2__)
+    // 4 values per iteration: index math in vector registers, scalar LUT loads
+    const __m128 v_min = _mm_set1_ps(range_min);
+    const __m128 v_scale = _mm_set1_ps(scale);
+    const __m128 v_zero = _mm_setzero_ps();
+    const __m128 v_top = _mm_set1_ps(static_cast<float>(LUT_SIZE - 1));
+    const __m128 v_half = _mm_set1_ps(0.5f);
+    const __m128i v_masked = _mm_set1_epi32(static_cast<int>(masked_color));
+    alignas(16) int32_t idx[4];
+    for (; i + 4 <= count; i += 4) {
+        __m128 pos = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(values + i), v_min), v_scale);
+        pos = _mm_min_ps(_mm_max_ps(pos, v_zero), v_top);
+        _mm_store_si128(reinterpret_cast<__m128i*>(idx), _mm_cvttps_epi32(_mm_add_ps(pos, v_half)));
+        __m128i rgba = _mm_setr_epi32(static_cast<int>(lut[idx[0]]), static_cast<int>(lut[idx[1]]),
+                                      static_cast<int>(lut[idx[2]]), static_cast<int>(lut[idx[3]]));
+        uint32_t bits = mask ? mask_bits(mask, i, 4) : 0;
+        if (bits) {
+            const __m128i v_lane_bits = _mm_setr_epi32(1, 2, 4, 8);
+            __m128i m = _mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), v_lane_bits);
+            m = _mm_cmpeq_epi32(m, v_lane_bits);
+            rgba = _mm_or_si128(_mm_andnot_si128(m, rgba), _mm_and_si128(m, v_masked));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), rgba);
+    }
+#endif
+
+    // Remainder (and the whole field without SIMD)
+    for (; i < count; ++i) {
+        out[i] = (mask && ((mask[i / 64] >> (i % 64)) & 1u)) ? masked_color : map(values[i]);
+    }
+}
+
+bool Colormap::palette_from_name(const std::string& name, Palette& out) {
+    if (name == "bgr") out = Palette::BlueGreenRed;
+    else if (name == "gray") out = Palette::Grayscale;
+    else if (name == "viridis") out = Palette::Viridis;
+    else if (name == "coolwarm") out = Palette::CoolWarm;
+    else return false;
+    return true;
+}
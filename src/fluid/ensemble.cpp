@@ -0,0 +1,259 @@
+#include <ensemble.hpp>
+#include <iostream>
+#include <cmath>
+#include <stdexcept>
+#include <bit>
+
+template <typename Scalar>
+BasicEnsembleFluid<Scalar>::BasicEnsembleFluid(int width, int height, Scalar cell_size,
+                                               const std::vector<Scalar>& viscosities,
+                                               const std::vector<Scalar>& gravities, CellOrdering ordering)
+    : grid_width(width), grid_height(height), instance_count(static_cast<int>(viscosities.size())),
+      cell_size(cell_size), layout(width, height, ordering, CX, CY, NUM_VELOCITIES),
+      viscosity(viscosities), gravity(gravities), step_count(0), pool(std::make_unique<ThreadPool>(1)) {
+    if (viscosities.empty() || viscosities.size() != gravities.size()) {
+        throw std::invalid_argument("Ensemble needs one viscosity and one gravity per instance");
+    }
+
+    dt = static_cast<Scalar>(cell_size / std::sqrt(2.0)); // Same stable time step as BasicBLWFluid
+    update_rates();
+
+    // All populations start at zero, all densities at 1 (as in BasicBLWFluid)
+    const size_t cell_count = static_cast<size_t>(width) * height;
+    populations.assign(cell_count * NUM_VELOCITIES * instance_count, Scalar(0));
+    next_populations.resize(populations.size());
+    density.assign(cell_count * instance_count, Scalar(1));
+    use_obstacle_set(std::make_shared<const ObstacleSet>(ObstacleManager(), layout, static_cast<float>(cell_size)));
+
+    std::cout << "[DEBUG] Ensemble: " << instance_count << " instances of " << width << "x" << height
+              << " cells" << std::endl;
+}
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::update_rates() {
+    omega.resize(instance_count);
+    gravity_dt.resize(instance_count);
+    for (int k = 0; k < instance_count; ++k) {
+        Scalar tau = Scalar(0.5) + (viscosity[k] * dt) / (cell_size * cell_size);
+        omega[k] = Scalar(1) / tau;
+        gravity_dt[k] = gravity[k] * dt;
+    }
+}
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::set_parameters(int instance, Scalar new_viscosity, Scalar new_gravity) {
+    viscosity[instance] = new_viscosity;
+    gravity[instance] = new_gravity;
+    update_rates();
+}
+
+// Direction with the opposite lattice velocity (-CX[i], -CY[i])
+static const int OPPOSITE[NUM_VELOCITIES] = {0, 3, 4, 1, 2, 7, 8, 5, 6};
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::update_boundary_links() {
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+    bounce_dirs.assign(static_cast<size_t>(layout.get_cell_count()), 0);
+    obstacles.for_each_fluid(0, bounce_dirs.size(), [&](size_t idx) {
+        const int32_t* neighbors = layout.neighbors(static_cast<int>(idx));
+        for (int i = 0; i < NUM_VELOCITIES; ++i) {
+            if (neighbors[i] < 0 || obstacles.test(neighbors[i])) {
+                bounce_dirs[idx] |= static_cast<uint16_t>(1u << i);
+            }
+        }
+    });
+}
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::use_obstacle_set(SharedObstacleSet set) {
+    obstacle_set = std::move(set);
+    update_boundary_links();
+}
+
+// Adding an obstacle re-rasterizes a copy of the polygons; the shared set never changes
+template <typename Scalar>
+bool BasicEnsembleFluid<Scalar>::add_obstacle_from_file(const std::string& filename) {
+    ObstacleManager geometry = obstacle_set->get_geometry();
+    if (!geometry.add_obstacle_from_file(filename)) return false;
+    use_obstacle_set(std::make_shared<const ObstacleSet>(std::move(geometry), layout, static_cast<float>(cell_size)));
+    return true;
+}
+
+template <typename Scalar>
+bool BasicEnsembleFluid<Scalar>::add_obstacle_from_vertices(const std::vector<Vec2>& vertices) {
+    ObstacleManager geometry = obstacle_set->get_geometry();
+    if (!geometry.add_obstacle_from_vertices(vertices)) return false;
+    use_obstacle_set(std::make_shared<const ObstacleSet>(std::move(geometry), layout, static_cast<float>(cell_size)));
+    return true;
+}
+
+template <typename Scalar>
+bool BasicEnsembleFluid<Scalar>::set_obstacles(SharedObstacleSet set) {
+    if (!set || !set->matches(layout, static_cast<float>(cell_size))) {
+        std::cerr << "[ERROR] Ensemble: Obstacle set does not match the grid" << std::endl;
+        return false;
+    }
+    use_obstacle_set(std::move(set));
+    return true;
+}
+
+// BGK collision of one cell for instances [k0, k0 + Lanes); the expressions match
+// BasicBLWFluid::collision term for term so every lane rounds the same way
+template <typename Scalar>
+template <int Lanes>
+void BasicEnsembleFluid<Scalar>::collide_lanes(size_t idx, int k0) {
+    const Scalar* w = LATTICE_WEIGHTS<Scalar>;
+    const size_t K = static_cast<size_t>(instance_count);
+    Scalar* f = &populations[idx * NUM_VELOCITIES * K + k0];
+    Scalar* rho = &density[idx * K + k0];
+
+    // Calculate macroscopic velocity (ux, uy)
+    Scalar ux[Lanes], uy[Lanes], u_sq[Lanes];
+    for (int l = 0; l < Lanes; ++l) ux[l] = uy[l] = 0;
+    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+        for (int l = 0; l < Lanes; ++l) {
+            ux[l] += CX[i] * f[i * K + l];
+            uy[l] += CY[i] * f[i * K + l];
+        }
+    }
+    for (int l = 0; l < Lanes; ++l) {
+        if (std::fabs(rho[l]) < 1e-6) rho[l] = 1; // Avoid division by zero
+        ux[l] /= rho[l];
+        uy[l] /= rho[l];
+        uy[l] += gravity_dt[k0 + l]; // Apply gravitational acceleration
+        u_sq[l] = ux[l] * ux[l] + uy[l] * uy[l];
+    }
+
+    // Relax towards the equilibrium distribution
+    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+        for (int l = 0; l < Lanes; ++l) {
+            Scalar cu = CX[i] * ux[l] + CY[i] * uy[l];
+            Scalar feq = w[i] * rho[l] * (Scalar(1) + Scalar(3) * cu + Scalar(4.5) * cu * cu - Scalar(1.5) * u_sq[l]);
+            Scalar o = omega[k0 + l];
+            f[i * K + l] = (Scalar(1) - o) * f[i * K + l] + o * feq;
+        }
+    }
+}
+
+template <typename Scalar>
+template <int Lanes>
+void BasicEnsembleFluid<Scalar>::density_lanes(size_t idx, int k0) {
+    const size_t K = static_cast<size_t>(instance_count);
+    const Scalar* f = &next_populations[idx * NUM_VELOCITIES * K + k0]; // Called before the swap
+    Scalar sum[Lanes];
+    for (int l = 0; l < Lanes; ++l) sum[l] = 0;
+    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+        for (int l = 0; l < Lanes; ++l) sum[l] += f[i * K + l];
+    }
+    Scalar* rho = &density[idx * K + k0];
+    for (int l = 0; l < Lanes; ++l) rho[l] = std::clamp(sum[l], Scalar(0.5), Scalar(1.5));
+}
+
+// Slot (idx, i) receives, in BasicBLWFluid's order: its own post-collision value, the value
+// streamed from the fluid cell idx - c_i, then the cell's bounce-back links in direction order
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::pull_cell(size_t idx) {
+    const size_t K = static_cast<size_t>(instance_count);
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+    const Scalar* own = &populations[idx * NUM_VELOCITIES * K];
+    Scalar* out = &next_populations[idx * NUM_VELOCITIES * K];
+    if (obstacles.test(idx)) {
+        std::copy(own, own + NUM_VELOCITIES * K, out); // Obstacle populations stay as they are
+        return;
+    }
+
+    const int32_t* neighbors = layout.neighbors(static_cast<int>(idx));
+    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+        const int source = neighbors[OPPOSITE[i]];
+        Scalar* target = out + i * K;
+        const Scalar* current = own + i * K;
+        if (source < 0 || obstacles.test(source)) {
+            std::copy(current, current + K, target);
+        } else {
+            const Scalar* streamed = &populations[(static_cast<size_t>(source) * NUM_VELOCITIES + i) * K];
+            for (size_t k = 0; k < K; ++k) target[k] = current[k] + streamed[k];
+        }
+    }
+    for (unsigned dirs = bounce_dirs[idx]; dirs != 0; dirs &= dirs - 1) {
+        const int i = std::countr_zero(dirs);
+        const int bounce_i = (i % 4 == 0) ? i : (i + 2) % 4; // Reverse direction (as in BasicBLWFluid)
+        const Scalar* reflected = own + i * K;
+        Scalar* target = out + bounce_i * K;
+        for (size_t k = 0; k < K; ++k) target[k] += reflected[k];
+    }
+
+    const int full_blocks = instance_count / LANE_BLOCK * LANE_BLOCK;
+    int k = 0;
+    for (; k < full_blocks; k += LANE_BLOCK) density_lanes<LANE_BLOCK>(idx, k);
+    for (; k < instance_count; ++k) density_lanes<1>(idx, k);
+}
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::update() {
+    TRACE_SCOPE("ensemble update", "solver");
+    const size_t cell_count = static_cast<size_t>(layout.get_cell_count());
+    const int full_blocks = instance_count / LANE_BLOCK * LANE_BLOCK;
+
+    // 1. Collision
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+    pool->parallel_for(cell_count, CELL_GRAIN, [&](size_t begin, size_t end) {
+        obstacles.for_each_fluid(begin, end, [&](size_t idx) {
+            int k = 0;
+            for (; k < full_blocks; k += LANE_BLOCK) collide_lanes<LANE_BLOCK>(idx, k);
+            for (; k < instance_count; ++k) collide_lanes<1>(idx, k);
+        });
+    });
+
+    // 2. Streaming + bounce-back + density, one cell at a time. Each cell writes only its
+    // own slots, so the bounce-back links run in parallel too.
+    pool->parallel_for(cell_count, CELL_GRAIN, [&](size_t begin, size_t end) {
+        for (size_t idx = begin; idx < end; ++idx) pull_cell(idx);
+    });
+    populations.swap(next_populations);
+    step_count++;
+}
+
+template <typename Scalar>
+void BasicEnsembleFluid<Scalar>::fill_snapshot(int instance, FieldSnapshot& snapshot) const {
+    TRACE_SCOPE("fill snapshot", "io");
+    const size_t count = static_cast<size_t>(grid_width) * grid_height;
+    const size_t K = static_cast<size_t>(instance_count);
+    snapshot.width = grid_width;
+    snapshot.height = grid_height;
+    snapshot.cell_size = static_cast<float>(cell_size);
+    snapshot.step = step_count;
+    snapshot.density.resize(count);
+    snapshot.velocity_x.resize(count);
+    snapshot.velocity_y.resize(count);
+    snapshot.obstacle.resize(count);
+    snapshot.obstacle_revision = 0; // No revision tracking: the mask is always copied
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+
+    for (int y = 0; y < grid_height; ++y) {
+        for (int x = 0; x < grid_width; ++x) {
+            const int idx = layout.index(x, y);
+            const size_t out = static_cast<size_t>(y) * grid_width + x;
+            const Scalar rho = density[idx * K + instance];
+
+            // Macroscopic velocity from the distribution functions (as in BasicBLWFluid)
+            Scalar ux = 0, uy = 0;
+            const bool obstacle = obstacles.test(idx);
+            if (!obstacle && std::fabs(rho) >= 1e-6) {
+                for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                    Scalar fi = populations[(static_cast<size_t>(idx) * NUM_VELOCITIES + i) * K + instance];
+                    ux += CX[i] * fi;
+                    uy += CY[i] * fi;
+                }
+                ux /= rho;
+                uy /= rho;
+            }
+            snapshot.density[out] = static_cast<float>(rho);
+            snapshot.velocity_x[out] = static_cast<float>(ux);
+            snapshot.velocity_y[out] = static_cast<float>(uy);
+            if (obstacle) snapshot.obstacle.set(out);
+        }
+    }
+}
+
+template class BasicEnsembleFluid<float>;
+template class BasicEnsembleFluid<double>;
@@ -2,30 +2,211 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <utility>
 
-BLWFluid::BLWFluid(int width, int height, float cell_size, float viscosity, float gravity)
+template <typename Scalar>
+BasicBLWFluid<Scalar>::BasicBLWFluid(int width, int height, Scalar cell_size, Scalar viscosity, Scalar gravity,
+                                     CellOrdering ordering, int tree_arity, PopulationPrecision precision)
     : grid_width(width), grid_height(height), cell_size(cell_size),
-      kinematic_viscosity(viscosity), gravity(gravity),
-      spatial_tree(Vec2(0.0f, 0.0f), Vec2(width * cell_size, height * cell_size), cell_size * 2.0f) {
+      layout(width, height, ordering, CX, CY, NUM_VELOCITIES), precision(precision), huge_pages(HugePageMode::Off),
+      kinematic_viscosity(viscosity), gravity(gravity), step_count(0), obstacle_revision(1),
+      pool(std::make_unique<ThreadPool>(1)), diagnostics_enabled(false), field_output_enabled(false),
+      field_step(-1) {
     
-    dt = cell_size / sqrt(2.0f); // Stable time step
-    cells.resize(width * height);
-    std::cout << "[DEBUG] BLWFluid: Cells resized to " << width * height << " elements" << std::endl;
-
-    // Initialize cell positions and check for obstacles
-    std::vector<Vec2> cell_positions;
-    cell_positions.reserve(width * height); // Preallocate for safety
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int idx = y * width + x;
-            cells[idx].pos = Vec2(x * cell_size, y * cell_size);
-            cells[idx].is_obstacle = obstacle_manager.is_point_obstructed(cells[idx].pos);
-            cells[idx].density = 1.0f; // Explicit default density (avoids NaNs)
-            // Initialize velocities to 0.0f (already done in FluidCell constructor)
-            cell_positions.push_back(cells[idx].pos);
+    dt = static_cast<Scalar>(cell_size / std::sqrt(2.0)); // Stable time step
+
+    // Cells start at density 1 and all populations at zero (as stored: 16-bit formats hold
+    // the deviation from W[i])
+    place_buffer(cells, 1, [](Cell* placed, size_t begin, size_t end) {
+        std::fill(placed + begin, placed + end, Cell(Scalar(1)));
+    });
+    with_populations([this](auto codec, auto& f) {
+        using Codec = decltype(codec);
+        const auto zero = [](auto* placed, size_t begin, size_t end) {
+            for (size_t k = begin; k < end; ++k) {
+                placed[k] = Codec::store(Scalar(0), LATTICE_WEIGHTS<Scalar>[k % NUM_VELOCITIES]);
+            }
+        };
+        place_buffer(f, NUM_VELOCITIES, zero);
+        place_buffer(streaming_target(f), NUM_VELOCITIES, zero);
+    });
+
+    set_field_output_enabled(true); // Also configures the profiler
+    std::cout << "[DEBUG] BLWFluid: Cells resized to " << width * height << " elements ("
+              << precision_name(precision) << " populations)" << std::endl;
+
+    // Geometry (positions, tree, obstacles) is float whatever the solver precision
+    const float world_cell = static_cast<float>(cell_size);
+
+    // No obstacles yet (positions are implicit in the lattice coordinates)
+    obstacle_set = std::make_shared<const ObstacleSet>(ObstacleManager(), layout, world_cell);
+    update_boundary_links();
+
+    // The tree indexes cells by storage index, so leaves reference cells in layout order
+    const CellPositions positions = get_cell_positions();
+    const SpatialIndex::PointPosition position = [&positions](size_t idx) {
+        return positions[static_cast<int>(idx)];
+    };
+
+    Vec2 world_min(0.0f, 0.0f);
+    Vec2 world_max(width * world_cell, height * world_cell);
+    float tree_threshold = world_cell * 2.0f;
+
+    if (tree_arity == TREE_ARITY_AUTO) {
+        // Sample 3x3-cell neighbourhood queries spread over the whole grid
+        std::vector<std::pair<Vec2, Vec2>> queries;
+        const int QUERY_STRIDE = 7;
+        for (int y = 1; y < height - 1; y += QUERY_STRIDE) {
+            for (int x = 1; x < width - 1; x += QUERY_STRIDE) {
+                queries.emplace_back(Vec2((x - 1) * world_cell, (y - 1) * world_cell),
+                                     Vec2((x + 1) * world_cell, (y + 1) * world_cell));
+            }
         }
+        tree_arity = select_fastest_arity(world_min, world_max, tree_threshold, positions.size(), position, queries);
+        std::cout << "[DEBUG] BLWFluid: Selected tree arity " << tree_arity << std::endl;
+    }
+
+    {
+        PhaseProfiler::Scope timer(profiler, ProfilePhase::Tree);
+        spatial_tree = make_spatial_index(tree_arity, world_min, world_max, tree_threshold);
+        spatial_tree->build(positions.size(), position);
+    }
+    std::cout << "[DEBUG] BLWFluid: Spatial tree (arity " << tree_arity << ") built with "
+              << positions.size() << " cells" << std::endl;
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::configure_profiler() {
+    // Estimated memory traffic per lattice update: cell data is read by collision and
+    // read + written by density (3); populations are read + written by collision (2),
+    // copied (2), streamed as source read + neighbour read-modify-write (3) and summed (1);
+    // the velocity planes are written once
+    const uint64_t population_size = NUM_VELOCITIES * population_bytes(precision);
+    const uint64_t field_size = field_output_enabled ? 2 * sizeof(Scalar) : 0;
+    profiler.configure(static_cast<uint64_t>(grid_width) * grid_height,
+                       sizeof(Cell) * 3 + population_size * 8 + field_size);
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::set_field_output_enabled(bool enabled) {
+    field_output_enabled = enabled;
+    field_step = -1; // Filled by the next update()
+    if (enabled) {
+        const auto zero = [](Scalar* placed, size_t begin, size_t end) {
+            std::fill(placed + begin, placed + end, Scalar(0));
+        };
+        place_buffer(velocity_x, 1, zero);
+        place_buffer(velocity_y, 1, zero);
+    } else {
+        LatticeVector<Scalar>().swap(velocity_x);
+        LatticeVector<Scalar>().swap(velocity_y);
+    }
+    configure_profiler();
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::place_lattice() {
+    const auto copy_of = [](const auto& source) {
+        return [&source](auto* placed, size_t begin, size_t end) {
+            std::copy(source.begin() + begin, source.begin() + end, placed + begin);
+        };
+    };
+    place_buffer(cells, 1, copy_of(cells));
+    with_populations([&](auto, auto& f) {
+        place_buffer(f, NUM_VELOCITIES, copy_of(f));
+        place_buffer(streaming_target(f), NUM_VELOCITIES, copy_of(streaming_target(f)));
+    });
+    if (field_output_enabled) {
+        place_buffer(velocity_x, 1, copy_of(velocity_x));
+        place_buffer(velocity_y, 1, copy_of(velocity_y));
     }
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::set_thread_count(int threads, ThreadPlacement placement) {
+    pool = std::make_unique<ThreadPool>(threads, placement);
+    if (placement == ThreadPlacement::Dynamic) return; // Chunks move between threads anyway
+    place_lattice();
+    std::cout << "[DEBUG] BLWFluid: Lattice placed for " << pool->size() << " " << placement_name(placement)
+              << " threads" << std::endl;
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::set_huge_pages(HugePageMode mode) {
+    huge_pages = mode;
+    place_lattice();
+    std::cout << "[DEBUG] BLWFluid: Lattice buffers use " << huge_pages_name(mode) << " huge pages" << std::endl;
+}
+
+template <typename Scalar>
+void BasicBLWFluid<Scalar>::fill_snapshot(FieldSnapshot& snapshot) const {
+    TRACE_SCOPE("fill snapshot", "io");
+    const size_t count = static_cast<size_t>(grid_width) * grid_height;
+    snapshot.width = grid_width;
+    snapshot.height = grid_height;
+    snapshot.cell_size = static_cast<float>(cell_size);
+    snapshot.step = step_count;
+    snapshot.density.resize(count);
+    snapshot.velocity_x.resize(count);
+    snapshot.velocity_y.resize(count);
+    const ObstacleMask& obstacles = obstacle_set->get_mask();
+
+    // Obstacles rarely change: skip the mask unless this snapshot has an older revision
+    if (snapshot.obstacle_revision != obstacle_revision || snapshot.obstacle.size() != count) {
+        if (layout.get_ordering() == CellOrdering::RowMajor) {
+            snapshot.obstacle = obstacles; // Same bit order (a mapped mask is shared, not copied)
+        } else {
+            snapshot.obstacle.resize(count);
+            obstacles.for_each_obstacle(0, count, [&](size_t idx) {
+                const int cell = static_cast<int>(idx);
+                snapshot.obstacle.set(static_cast<size_t>(layout.cell_y(cell)) * grid_width + layout.cell_x(cell));
+            });
+        }
+    }
+    snapshot.obstacle_revision = obstacle_revision;
+
+    // Fast path: velocity was written by the kernel, only reorder to row-major
+    if (has_velocity_field()) {
+        for (int y = 0; y < grid_height; ++y) {
+            for (int x = 0; x < grid_width; ++x) {
+                const int idx = layout.index(x, y);
+                const Cell& cell = cells[idx];
+                size_t out = static_cast<size_t>(y) * grid_width + x;
+                snapshot.density[out] = static_cast<float>(cell.density);
+                snapshot.velocity_x[out] = static_cast<float>(velocity_x[idx]);
+                snapshot.velocity_y[out] = static_cast<float>(velocity_y[idx]);
+            }
+        }
+        return;
+    }
+
+    with_populations([&](auto codec, const auto& f) {
+        using Codec = decltype(codec);
+        for (int y = 0; y < grid_height; ++y) {
+            for (int x = 0; x < grid_width; ++x) {
+                const int idx = layout.index(x, y);
+                const Cell& cell = cells[idx];
+                size_t out = static_cast<size_t>(y) * grid_width + x;
+
+                // Macroscopic velocity from the distribution functions (as in collision())
+                Scalar ux = 0, uy = 0;
+                if (!obstacles.test(idx) && std::fabs(cell.density) >= 1e-6) {
+                    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                        Scalar fi = Codec::load(f[static_cast<size_t>(idx) * NUM_VELOCITIES + i], LATTICE_WEIGHTS<Scalar>[i]);
+                        ux += CX[i] * fi;
+                        uy += CY[i] * fi;
+                    }
+                    ux /= cell.density;
+                    uy /= cell.density;
+                }
+
+                snapshot.density[out] = static_cast<float>(cell.density);
+                snapshot.velocity_x[out] = static_cast<float>(ux);
+                snapshot.velocity_y[out] = static_cast<float>(uy);
+            }
+        }
+    });
+}
 
-    spatial_tree.build(cell_positions);
-    std::cout << "[DEBUG] BLWFluid: Spatial tree built with " << cell_positions.size() << " cells" << std::endl;
-}
\ No newline at end of file
+template class BasicBLWFluid<float>;
+template class BasicBLWFluid<double>;
@@ -0,0 +1,358 @@
+#include <frame_sink.hpp>
+#include <trace.hpp>
+
+#include <iostream>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+// CRC-32 (PNG chunks), table built on first use
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t length) {
+    static const auto table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+// Adler-32 (zlib stream trailer)
+static uint32_t adler32(const uint8_t* data, size_t length) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < length; ++i) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+static void append_be32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back(static_cast<uint8_t>(v >> 24));
+    out.push_back(static_cast<uint8_t>(v >> 16));
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+// Append a PNG chunk (length, type, data, CRC over type + data)
+static void append_png_chunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, size_t length) {
+    append_be32(out, static_cast<uint32_t>(length));
+    size_t type_pos = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data, data + length);
+    append_be32(out, crc32_update(0, out.data() + type_pos, length + 4));
+}
+
+FrameSink::FrameSink(const FrameSinkConfig& config)
+    : config(config),
+      colormap(config.palette, config.range_min, config.range_max),
+      stopping(false),
+      busy(false),
+      frames_written(0),
+      frames_dropped(0),
+      frames_failed(0),
+      stream_width(0),
+      stream_height(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(config.output_dir, ec);
+    if (ec) {
+        throw std::runtime_error("Failed to create frame output directory: " + config.output_dir);
+    }
+    if (this->config.queue_capacity == 0) this->config.queue_capacity = 1;
+
+    writer = std::thread(&FrameSink::writer_loop, this);
+    std::cout << "[DEBUG] FrameSink: Writing " << field_name(config.field) << " frames to "
+              << config.output_dir << std::endl;
+}
+
+FrameSink::~FrameSink() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queue_changed.notify_all();
+    writer.join();
+
+    if (frames_dropped > 0 || frames_failed > 0) {
+        std::cerr << "[WARNING] FrameSink: " << frames_dropped << " frames dropped, "
+                  << frames_failed << " failed" << std::endl;
+    }
+}
+
+bool FrameSink::submit(const FieldSnapshot& snapshot) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (pending.size() >= config.queue_capacity) {
+        if (!config.block_when_full) {
+            frames_dropped++;
+            return false;
+        }
+        queue_changed.wait(lock, [this] { return pending.size() < config.queue_capacity; });
+    }
+
+    // Reuse a written slot so the copy does not allocate once the sink is warm
+    if (!spare.empty()) {
+        pending.push_back(std::move(spare.back()));
+        spare.pop_back();
+    } else {
+        pending.emplace_back();
+    }
+    pending.back() = snapshot;
+    lock.unlock();
+
+    queue_changed.notify_all();
+    return true;
+}
+
+void FrameSink::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_changed.wait(lock, [this] { return pending.empty() && !busy; });
+}
+
+size_t FrameSink::get_frames_written() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames_written;
+}
+
+size_t FrameSink::get_frames_dropped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames_dropped;
+}
+
+size_t FrameSink::get_frames_failed() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames_failed;
+}
+
+void FrameSink::writer_loop() {
+    Tracer::set_thread_name("frame writer");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queue_changed.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) break; // Stopping and fully drained
+
+        FieldSnapshot frame = std::move(pending.front());
+        pending.pop_front();
+        busy = true;
+        lock.unlock();
+        queue_changed.notify_all(); // Wake a blocked submit()
+
+        bool ok = write_frame(frame);
+
+        lock.lock();
+        busy = false;
+        if (ok) frames_written++;
+        else frames_failed++;
+        spare.push_back(std::move(frame));
+        queue_changed.notify_all(); // Wake flush()
+    }
+    lock.unlock();
+
+    if (stream.is_open()) stream.close();
+}
+
+std::string FrameSink::frame_path(long step, const char* extension) const {
+    char name[64];
+    std::snprintf(name, sizeof(name), "%s_%06ld.%s", field_name(config.field), step, extension);
+    return (std::filesystem::path(config.output_dir) / name).string();
+}
+
+bool FrameSink::write_frame(const FieldSnapshot& snapshot) {
+    TRACE_SCOPE("write frame", "io");
+    compute_field(snapshot);
+
+    rgba.resize(values.size());
+    const uint64_t* mask = snapshot.obstacle.size() == values.size() ? snapshot.obstacle.words() : nullptr;
+    colormap.map_field(values.data(), mask, values.size(), rgba.data()); // Obstacles come out black
+
+    switch (config.format) {
+        case FrameFormat::Y4M: return write_y4m(snapshot);
+        case FrameFormat::PNG: return write_png(snapshot, frame_path(snapshot.step, "png"));
+        case FrameFormat::PPM:
+        default:               return write_ppm(snapshot, frame_path(snapshot.step, "ppm"));
+    }
+}
+
+void FrameSink::compute_field(const FieldSnapshot& snapshot) {
+    const int w = snapshot.width;
+    const int h = snapshot.height;
+    const size_t count = static_cast<size_t>(w) * h;
+    values.resize(count);
+
+    switch (config.field) {
+        case FrameField::Speed:
+            for (size_t i = 0; i < count; ++i) {
+                values[i] = std::sqrt(snapshot.velocity_x[i] * snapshot.velocity_x[i] +
+                                      snapshot.velocity_y[i] * snapshot.velocity_y[i]);
+            }
+            break;
+
+        case FrameField::Vorticity:
+            // Central differences, one-sided at the grid edges
+            for (int y = 0; y < h; ++y) {
+                int y0 = std::max(y - 1, 0), y1 = std::min(y + 1, h - 1);
+                for (int x = 0; x < w; ++x) {
+                    int x0 = std::max(x - 1, 0), x1 = std::min(x + 1, w - 1);
+                    float dvy_dx = x1 > x0 ? (snapshot.velocity_y[static_cast<size_t>(y) * w + x1] -
+                                              snapshot.velocity_y[static_cast<size_t>(y) * w + x0]) / (x1 - x0) : 0.0f;
+                    float dvx_dy = y1 > y0 ? (snapshot.velocity_x[static_cast<size_t>(y1) * w + x] -
+                                              snapshot.velocity_x[static_cast<size_t>(y0) * w + x]) / (y1 - y0) : 0.0f;
+                    values[static_cast<size_t>(y) * w + x] = dvy_dx - dvx_dy;
+                }
+            }
+            break;
+
+        case FrameField::Density:
+        default:
+            std::copy(snapshot.density.begin(), snapshot.density.end(), values.begin());
+            break;
+    }
+}
+
+bool FrameSink::write_ppm(const FieldSnapshot& snapshot, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] FrameSink: Failed to open output file - " << path << std::endl;
+        return false;
+    }
+
+    bytes.resize(rgba.size() * 3);
+    for (size_t i = 0; i < rgba.size(); ++i) {
+        bytes[i * 3 + 0] = static_cast<uint8_t>(rgba[i]);
+        bytes[i * 3 + 1] = static_cast<uint8_t>(rgba[i] >> 8);
+        bytes[i * 3 + 2] = static_cast<uint8_t>(rgba[i] >> 16);
+    }
+
+    file << "P6\n" << snapshot.width << " " << snapshot.height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(file);
+}
+
+// PNG with stored (uncompressed) deflate blocks: no zlib dependency, and encoding
+// stays a memory copy so the writer keeps up with high frame rates
+bool FrameSink::write_png(const FieldSnapshot& snapshot, const std::string& path) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] FrameSink: Failed to open output file - " << path << std::endl;
+        return false;
+    }
+
+    const size_t row_bytes = static_cast<size_t>(snapshot.width) * 3 + 1; // Filter byte + RGB
+    std::vector<uint8_t> raw(row_bytes * snapshot.height);
+    for (int y = 0; y < snapshot.height; ++y) {
+        uint8_t* row = &raw[y * row_bytes];
+        row[0] = 0; // Filter type: None
+        for (int x = 0; x < snapshot.width; ++x) {
+            uint32_t c = rgba[static_cast<size_t>(y) * snapshot.width + x];
+            row[1 + x * 3 + 0] = static_cast<uint8_t>(c);
+            row[1 + x * 3 + 1] = static_cast<uint8_t>(c >> 8);
+            row[1 + x * 3 + 2] = static_cast<uint8_t>(c >> 16);
+        }
+    }
+
+    // zlib stream: header, stored blocks of at most 65535 bytes, Adler-32
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    const size_t MAX_STORED = 65535;
+    for (size_t pos = 0; pos < raw.size() || pos == 0; pos += MAX_STORED) {
+        size_t length = std::min(MAX_STORED, raw.size() - pos);
+        bool last = pos + length >= raw.size();
+        zlib.push_back(last ? 1 : 0);
+        zlib.push_back(static_cast<uint8_t>(length));
+        zlib.push_back(static_cast<uint8_t>(length >> 8));
+        zlib.push_back(static_cast<uint8_t>(~length));
+        zlib.push_back(static_cast<uint8_t>(~length >> 8));
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+        if (last) break;
+    }
+    append_be32(zlib, adler32(raw.data(), raw.size()));
+
+    std::vector<uint8_t> header;
+    append_be32(header, static_cast<uint32_t>(snapshot.width));
+    append_be32(header, static_cast<uint32_t>(snapshot.height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8-bit RGB, deflate, no filter/interlace extras
+
+    static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bytes.assign(SIGNATURE, SIGNATURE + 8);
+    append_png_chunk(bytes, "IHDR", header.data(), header.size());
+    append_png_chunk(bytes, "IDAT", zlib.data(), zlib.size());
+    append_png_chunk(bytes, "IEND", nullptr, 0);
+
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(file);
+}
+
+// Append one frame to '<field>.y4m' (full-range BT.601 4:4:4)
+bool FrameSink::write_y4m(const FieldSnapshot& snapshot) {
+    if (!stream.is_open()) {
+        std::string path = (std::filesystem::path(config.output_dir) /
+                            (std::string(field_name(config.field)) + ".y4m")).string();
+        stream.open(path, std::ios::binary);
+        if (!stream.is_open()) {
+            std::cerr << "[ERROR] FrameSink: Failed to open output file - " << path << std::endl;
+            return false;
+        }
+        stream << "YUV4MPEG2 W" << snapshot.width << " H" << snapshot.height << " F" << config.frame_rate
+               << ":1 Ip A1:1 C444 XCOLORRANGE=FULL\n";
+        stream_width = snapshot.width;
+        stream_height = snapshot.height;
+    }
+    if (snapshot.width != stream_width || snapshot.height != stream_height) {
+        std::cerr << "[ERROR] FrameSink: Y4M frame size changed mid-stream" << std::endl;
+        return false;
+    }
+
+    const size_t count = rgba.size();
+    bytes.resize(count * 3);
+    uint8_t* plane_y = bytes.data();
+    uint8_t* plane_u = plane_y + count;
+    uint8_t* plane_v = plane_u + count;
+    for (size_t i = 0; i < count; ++i) {
+        float r = static_cast<float>(rgba[i] & 0xFF);
+        float g = static_cast<float>((rgba[i] >> 8) & 0xFF);
+        float b = static_cast<float>((rgba[i] >> 16) & 0xFF);
+        plane_y[i] = static_cast<uint8_t>(std::clamp(0.299f * r + 0.587f * g + 0.114f * b + 0.5f, 0.0f, 255.0f));
+        plane_u[i] = static_cast<uint8_t>(std::clamp(128.5f - 0.168736f * r - 0.331264f * g + 0.5f * b, 0.0f, 255.0f));
+        plane_v[i] = static_cast<uint8_t>(std::clamp(128.5f + 0.5f * r - 0.418688f * g - 0.081312f * b, 0.0f, 255.0f));
+    }
+
+    stream << "FRAME\n";
+    stream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    stream.flush();
+    return static_cast<bool>(stream);
+}
+
+bool FrameSink::field_from_name(const std::string& name, FrameField& out) {
+    if (name == "density") out = FrameField::Density;
+    else if (name == "speed") out = FrameField::Speed;
+    else if (name == "vorticity") out = FrameField::Vorticity;
+    else return false;
+    return true;
+}
+
+bool FrameSink::format_from_name(const std::string& name, FrameFormat& out) {
+    if (name == "ppm") out = FrameFormat::PPM;
+    else if (name == "y4m") out = FrameFormat::Y4M;
+    else if (name == "png") out = FrameFormat::PNG;
+    else return false;
+    return true;
+}
+
+const char* FrameSink::field_name(FrameField field) {
+    switch (field) {
+        case FrameField::Speed:     return "speed";
+        case FrameField::Vorticity: return "vorticity";
+        case FrameField::Density:
+        default:                    return "density";
+    }
+}
@@ -0,0 +1,75 @@
+#include <lattice_layout.hpp>
+
+#include <algorithm>
+#include <numeric>
+
+// Spread the lower 32 bits of v so that bit k moves to bit 2k (Morton helper)
+static uint64_t spread_bits(uint32_t v) {
+    uint64_t x = v;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+LatticeLayout::LatticeLayout(int width, int height, CellOrdering ordering,
+                             const int* cx, const int* cy, int num_dirs)
+    : width(width), height(height), num_directions(num_dirs), ordering(ordering) {
+    if (width <= 0 || height <= 0) {
+        throw std::invalid_argument("Invalid lattice size: width and height must be positive");
+    }
+
+    const int count = width * height;
+
+    // Non-row-major orderings: rank cells by curve key. Keys of a padded curve are
+    // sparse for non-power-of-two grids, so ranking compacts them into [0, count).
+    if (ordering != CellOrdering::RowMajor) {
+        std::vector<uint64_t> keys(count);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                keys[y * width + x] = ordering_key(x, y);
+            }
+        }
+
+        linear_of.resize(count);
+        std::iota(linear_of.begin(), linear_of.end(), 0);
+        std::sort(linear_of.begin(), linear_of.end(),
+                  [&keys](int32_t a, int32_t b) { return keys[a] < keys[b]; });
+
+        storage_of.resize(count);
+        for (int idx = 0; idx < count; ++idx) {
+            storage_of[linear_of[idx]] = idx;
+        }
+    }
+
+    // Neighbour table in storage order so the streaming loop reads it sequentially
+    neighbor_table.resize(static_cast<size_t>(count) * num_dirs);
+    for (int idx = 0; idx < count; ++idx) {
+        int x = cell_x(idx);
+        int y = cell_y(idx);
+        for (int i = 0; i < num_dirs; ++i) {
+            int nx = x + cx[i];
+            int ny = y + cy[i];
+            bool inside = nx >= 0 && nx < width && ny >= 0 && ny < height;
+            neighbor_table[static_cast<size_t>(idx) * num_dirs + i] = inside ? index(nx, ny) : -1;
+        }
+    }
+}
+
+uint64_t LatticeLayout::ordering_key(int x, int y) const {
+    switch (ordering) {
+        case CellOrdering::Tiled: {
+            int tiles_x = (width + TILE_SIZE - 1) / TILE_SIZE;
+            uint64_t tile = static_cast<uint64_t>(y / TILE_SIZE) * tiles_x + (x / TILE_SIZE);
+            uint64_t local = static_cast<uint64_t>(y % TILE_SIZE) * TILE_SIZE + (x % TILE_SIZE);
+            return tile * TILE_SIZE * TILE_SIZE + local;
+        }
+        case CellOrdering::Morton:
+            return spread_bits(static_cast<uint32_t>(x)) | (spread_bits(static_cast<uint32_t>(y)) << 1);
+        case CellOrdering::RowMajor:
+        default:
+            return static_cast<uint64_t>(y) * width + x;
+    }
+}
@@ -0,0 +1,97 @@
+#include <lattice_memory.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+static const size_t CACHE_LINE = 64;
+
+bool huge_pages_from_name(const std::string& name, HugePageMode& out) {
+    if (name == "off") out = HugePageMode::Off;
+    else if (name == "thp") out = HugePageMode::Transparent;
+    else if (name == "hugetlb") out = HugePageMode::HugeTLB;
+    else return false;
+    return true;
+}
+
+const char* huge_pages_name(HugePageMode mode) {
+    switch (mode) {
+        case HugePageMode::Transparent: return "thp";
+        case HugePageMode::HugeTLB: return "hugetlb";
+        default: return "off";
+    }
+}
+
+// Blocks mapped directly (rounded up to whole huge pages) instead of coming from operator new
+static bool uses_mapping(size_t bytes, HugePageMode mode) {
+#if defined(__linux__)
+    return mode != HugePageMode::Off && bytes >= HUGE_PAGE_SIZE;
+#else
+    (void)bytes;
+    (void)mode;
+    return false;
+#endif
+}
+
+#if defined(__linux__)
+static size_t mapping_size(size_t bytes) {
+    return (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+}
+
+// Anonymous mapping of 'length' bytes starting on a huge page boundary, advised for THP
+static void* map_transparent(size_t length) {
+    // Over-map by one huge page and trim both ends to the aligned range
+    const size_t padded = length + HUGE_PAGE_SIZE;
+    void* raw = mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(raw);
+    const uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned > start) munmap(raw, aligned - start);
+    const uintptr_t tail = aligned + length;
+    if (start + padded > tail) munmap(reinterpret_cast<void*>(tail), start + padded - tail);
+#ifdef MADV_HUGEPAGE
+    madvise(reinterpret_cast<void*>(aligned), length, MADV_HUGEPAGE);
+#endif
+    return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+void* allocate_lattice_block(size_t bytes, HugePageMode mode) {
+    if (!uses_mapping(bytes, mode)) {
+        return ::operator new(bytes, std::align_val_t(CACHE_LINE));
+    }
+#if defined(__linux__)
+    const size_t length = mapping_size(bytes);
+#ifdef MAP_HUGETLB
+    if (mode == HugePageMode::HugeTLB) {
+        void* block = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (block != MAP_FAILED) return block;
+
+        // Reserved pool empty or too small: say so once, then use transparent huge pages
+        static std::atomic<bool> warned(false);
+        if (!warned.exchange(true)) {
+            std::cerr << "[WARNING] LatticeMemory: No reserved huge pages (vm.nr_hugepages), "
+                      << "using transparent huge pages" << std::endl;
+        }
+    }
+#endif
+    void* block = map_transparent(length);
+    if (block) return block;
+#endif
+    throw std::bad_alloc();
+}
+
+void free_lattice_block(void* block, size_t bytes, HugePageMode mode) {
+    if (!block) return;
+    if (!uses_mapping(bytes, mode)) {
+        ::operator delete(block, std::align_val_t(CACHE_LINE));
+        return;
+    }
+#if defined(__linux__)
+    munmap(block, mapping_size(bytes));
+#endif
+}
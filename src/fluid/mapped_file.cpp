@@ -0,0 +1,122 @@
+#include <mapped_file.hpp>
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& filename, bool sequential) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+    file = handle;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size) || size.QuadPart == 0) return false;
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) return false;
+    bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(size.QuadPart);
+#else
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) return false;
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) return false;
+    if (sequential) madvise(mapped, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    bytes = static_cast<const uint8_t*>(mapped);
+    length = static_cast<size_t>(info.st_size);
+#endif
+    return bytes != nullptr;
+}
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (bytes) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+#else
+    if (bytes) munmap(const_cast<uint8_t*>(bytes), length);
+    if (fd >= 0) ::close(fd);
+#endif
+}
+
+uint64_t section_checksum(const uint8_t* data, size_t length, uint64_t seed) {
+    const uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+    uint64_t lane[4] = {seed + 1, seed + 2, seed + 3, seed + 4};
+    auto mix = [PRIME](uint64_t h, uint64_t word) {
+        h = (h ^ word) * PRIME;
+        return (h << 31) | (h >> 33);
+    };
+
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        uint64_t words[4];
+        std::memcpy(words, data + i, sizeof(words));
+        for (int k = 0; k < 4; ++k) lane[k] = mix(lane[k], words[k]);
+    }
+    for (; i + 8 <= length; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        lane[0] = mix(lane[0], word);
+    }
+    if (i < length) {
+        uint64_t word = 0;
+        std::memcpy(&word, data + i, length - i);
+        lane[1] = mix(lane[1], word);
+    }
+
+    uint64_t h = length;
+    for (int k = 0; k < 4; ++k) h = mix(h, lane[k]);
+    h ^= h >> 29;
+    return h;
+}
+
+bool write_sections(const std::string& filename, std::initializer_list<FileSection> sections, const char* module) {
+    std::string temp_file = filename + ".tmp";
+    {
+        std::ofstream file(temp_file, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "[ERROR] " << module << ": Failed to open output file - " << temp_file << std::endl;
+            return false;
+        }
+
+        // One large sequential write per section, zero padding up to the next aligned offset
+        static const char zeros[SECTION_ALIGNMENT] = {};
+        uint64_t position = 0;
+        for (const FileSection& section : sections) {
+            file.write(zeros, static_cast<std::streamsize>(section.offset - position));
+            file.write(static_cast<const char*>(section.data), static_cast<std::streamsize>(section.length));
+            position = section.offset + section.length;
+        }
+
+        if (!file) {
+            std::cerr << "[ERROR] " << module << ": Write failed - " << temp_file << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temp_file, filename, ec);
+    if (ec) {
+        std::cerr << "[ERROR] " << module << ": Failed to replace " << filename << " - " << ec.message() << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -1,11 +1,75 @@
-// filepath: d:\MTY\Code\cpp\fluid\src\fluid\nary_tree.cpp
-// This source file intentionally left minimal: NaryTree is implemented entirely
-// in the header (nary_tree.hpp) as a header-only template. Keeping an empty
-// translation unit avoids duplicate-definition/linker issues when the header
-// contains full template definitions.
+// NaryTree itself is header-only; this translation unit holds the explicit
+// instantiations for the arities selectable at runtime, the arity factory and
+// the build/query benchmark used to pick an arity automatically.
 
 #include <nary_tree.hpp>
 
-// No out-of-class template definitions or explicit instantiations here.
-// If explicit instantiation is required in the future, enable it carefully
-// to avoid multiple-definition errors.
\ No newline at end of file
+#include <chrono>
+#include <iostream>
+#include <limits>
+#include <string>
+
+template class NaryTree<2>;
+template class NaryTree<4>;
+template class NaryTree<8>;
+template class NaryTree<16>;
+
+std::unique_ptr<SpatialIndex> make_spatial_index(int arity, const Vec2& world_min,
+                                                 const Vec2& world_max, float threshold) {
+    switch (arity) {
+        case 2:  return std::make_unique<NaryTree<2>>(world_min, world_max, threshold);
+        case 4:  return std::make_unique<NaryTree<4>>(world_min, world_max, threshold);
+        case 8:  return std::make_unique<NaryTree<8>>(world_min, world_max, threshold);
+        case 16: return std::make_unique<NaryTree<16>>(world_min, world_max, threshold);
+        default:
+            throw std::invalid_argument("Unsupported tree arity: " + std::to_string(arity) +
+                                        " (supported: 2, 4, 8, 16)");
+    }
+}
+
+int select_fastest_arity(const Vec2& world_min, const Vec2& world_max, float threshold,
+                         size_t count, const SpatialIndex::PointPosition& position,
+                         const std::vector<std::pair<Vec2, Vec2>>& queries,
+                         std::vector<ArityBenchmark>* report) {
+    using clock = std::chrono::steady_clock;
+    const int REPEATS = 3; // Best-of-N to filter out scheduler noise
+
+    int best_arity = SUPPORTED_TREE_ARITIES[0];
+    double best_cost = std::numeric_limits<double>::max();
+
+    for (int arity : SUPPORTED_TREE_ARITIES) {
+        double build_ms = std::numeric_limits<double>::max();
+        double query_ms = std::numeric_limits<double>::max();
+
+        for (int r = 0; r < REPEATS; ++r) {
+            auto t0 = clock::now();
+            std::unique_ptr<SpatialIndex> tree = make_spatial_index(arity, world_min, world_max, threshold);
+            tree->build(count, position);
+            auto t1 = clock::now();
+
+            size_t hits = 0;
+            for (const auto& q : queries) {
+                hits += tree->query_range(q.first, q.second).size();
+            }
+            auto t2 = clock::now();
+
+            // Keep 'hits' observable so the query loop cannot be optimized away
+            if (hits == std::numeric_limits<size_t>::max()) std::cout << hits;
+
+            build_ms = std::min(build_ms, std::chrono::duration<double, std::milli>(t1 - t0).count());
+            query_ms = std::min(query_ms, std::chrono::duration<double, std::milli>(t2 - t1).count());
+        }
+
+        std::cout << "[DEBUG] NaryTree: arity " << arity << " - build " << build_ms
+                  << " ms, " << queries.size() << " queries " << query_ms << " ms" << std::endl;
+        if (report) {
+            report->push_back({arity, build_ms, query_ms});
+        }
+        if (build_ms + query_ms < best_cost) {
+            best_cost = build_ms + query_ms;
+            best_arity = arity;
+        }
+    }
+
+    return best_arity;
+}
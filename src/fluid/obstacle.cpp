@@ -1,10 +1,11 @@
 #include <obstacle.hpp>
-#include <GLFW/glfw3.h>
 
 #include <fstream>
 #include <sstream>
 #include <cmath>
 #include <iostream>
+#include <algorithm>
+#include <limits>
 
 // PolygonObstacle constructor
 PolygonObstacle::PolygonObstacle()
@@ -64,6 +65,41 @@ bool PolygonObstacle::point_inside(const Vec2& p) const {
     return inside;
 }
 
+// First cell x in [0, width] with x * cell_size >= bound (float products, as point_inside() sees them)
+static int first_cell_at_or_after(float bound, float cell_size, int width) {
+    if (!(bound > 0.0f)) return 0;
+    if (bound > width * cell_size) return width;
+    int x = std::clamp(static_cast<int>(std::ceil(bound / cell_size)), 0, width);
+    while (x > 0 && (x - 1) * cell_size >= bound) --x;
+    while (x < width && x * cell_size < bound) ++x;
+    return x;
+}
+
+// A cell at px is inside when an odd number of edge crossings lie to its right
+// (px < crossing, as in point_inside()). With m sorted crossings c[0..m), cells in
+// [c[k-1], c[k]) see m - k of them.
+void PolygonObstacle::row_spans(float y, float cell_size, int width, std::vector<CellSpan>& spans) const {
+    size_t n = (vertices.size() >= 1) ? vertices.size() - 1 : 0;
+    if (n == 0 || width <= 0) return;
+
+    std::vector<float> crossings;
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+        if ((vertices[i].y > y) != (vertices[j].y > y)) {
+            crossings.push_back((vertices[j].x - vertices[i].x) * (y - vertices[i].y) / (vertices[j].y - vertices[i].y) + vertices[i].x);
+        }
+    }
+    if (crossings.empty()) return;
+    std::sort(crossings.begin(), crossings.end());
+
+    const size_t m = crossings.size();
+    for (size_t k = (m % 2 == 1) ? 0 : 1; k < m; k += 2) {
+        float lo = k == 0 ? -std::numeric_limits<float>::infinity() : crossings[k - 1];
+        int begin = first_cell_at_or_after(lo, cell_size, width);
+        int end = first_cell_at_or_after(crossings[k], cell_size, width);
+        if (begin < end) spans.push_back({begin, end});
+    }
+}
+
 // ObstacleManager constructor
 ObstacleManager::ObstacleManager() {}
 
@@ -98,6 +134,12 @@ bool ObstacleManager::is_point_obstructed(const Vec2& p) const {
     return false;
 }
 
+void ObstacleManager::row_spans(float y, float cell_size, int width, std::vector<CellSpan>& spans) const {
+    for (const auto& obs : obstacles) {
+        obs.row_spans(y, cell_size, width, spans);
+    }
+}
+
 size_t ObstacleManager::get_obstacle_count() const {
     return obstacles.size();
 }
\ No newline at end of file
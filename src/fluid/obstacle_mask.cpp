@@ -0,0 +1,92 @@
+#include <obstacle_mask.hpp>
+#include <obstacle.hpp>
+#include <lattice_layout.hpp>
+#include <trace.hpp>
+
+ObstacleMask ObstacleMask::view(const uint64_t* words, size_t count, std::shared_ptr<const void> owner) {
+    ObstacleMask mask;
+    mask.data = words;
+    mask.owner = std::move(owner);
+    mask.cell_count = count;
+    return mask;
+}
+
+void ObstacleMask::make_owned() {
+    bits.assign(data, data + word_count());
+    data = bits.data();
+    owner.reset();
+}
+
+void ObstacleMask::resize(size_t count) {
+    cell_count = count;
+    bits.assign((count + WORD_BITS - 1) / WORD_BITS, 0);
+    data = bits.data();
+    owner.reset();
+}
+
+void ObstacleMask::clear() {
+    if (owner) {
+        resize(cell_count);
+        return;
+    }
+    std::fill(bits.begin(), bits.end(), 0);
+}
+
+// Partial words at both ends are masked, the words in between are filled directly
+void ObstacleMask::set_span(size_t begin, size_t end) {
+    end = std::min(end, cell_count);
+    if (begin >= end) return;
+    if (owner) make_owned();
+    const size_t first = begin / WORD_BITS;
+    const size_t last = (end - 1) / WORD_BITS;
+    const uint64_t head = ~uint64_t(0) << (begin % WORD_BITS);
+    const uint64_t tail = ~uint64_t(0) >> (WORD_BITS - 1 - (end - 1) % WORD_BITS);
+    if (first == last) {
+        bits[first] |= head & tail;
+        return;
+    }
+    bits[first] |= head;
+    std::fill(bits.begin() + first + 1, bits.begin() + last, ~uint64_t(0));
+    bits[last] |= tail;
+}
+
+size_t ObstacleMask::count() const {
+    size_t total = 0;
+    for (size_t w = 0; w < word_count(); ++w) total += static_cast<size_t>(std::popcount(data[w]));
+    return total;
+}
+
+size_t ObstacleMask::count(size_t begin, size_t end) const {
+    end = std::min(end, cell_count);
+    if (begin >= end) return 0;
+    const size_t first = begin / WORD_BITS;
+    const size_t last = (end - 1) / WORD_BITS;
+    const uint64_t head = ~uint64_t(0) << (begin % WORD_BITS);
+    const uint64_t tail = ~uint64_t(0) >> (WORD_BITS - 1 - (end - 1) % WORD_BITS);
+    if (first == last) return static_cast<size_t>(std::popcount(data[first] & head & tail));
+    size_t total = static_cast<size_t>(std::popcount(data[first] & head));
+    for (size_t w = first + 1; w < last; ++w) total += static_cast<size_t>(std::popcount(data[w]));
+    return total + static_cast<size_t>(std::popcount(data[last] & tail));
+}
+
+void rasterize_obstacles(const ObstacleManager& manager, const LatticeLayout& layout, float cell_size,
+                         ObstacleMask& mask) {
+    TRACE_SCOPE("obstacle voxelization", "obstacles");
+    const int width = layout.get_width();
+    const bool row_major = layout.get_ordering() == CellOrdering::RowMajor;
+    mask.resize(static_cast<size_t>(layout.get_cell_count()));
+    std::vector<CellSpan> spans;
+    for (int y = 0; y < layout.get_height(); ++y) {
+        spans.clear();
+        manager.row_spans(y * cell_size, cell_size, width, spans);
+        for (const CellSpan& span : spans) {
+            if (row_major) {
+                // Row-major rows are contiguous in storage: set the span word by word
+                const size_t first = static_cast<size_t>(layout.index(span.begin, y));
+                mask.set_span(first, first + (span.end - span.begin));
+            } else {
+                for (int x = span.begin; x < span.end; ++x) mask.set(layout.index(x, y));
+            }
+        }
+    }
+}
@@ -0,0 +1,170 @@
+#include <obstacle_set.hpp>
+#include <mapped_file.hpp>
+#include <trace.hpp>
+
+#include <iostream>
+#include <stdexcept>
+#include <cstring>
+
+static const char OBSTACLE_SET_MAGIC[8] = {'B', 'L', 'W', 'O', 'B', 'S', 'T', '\0'};
+static const uint32_t OBSTACLE_SET_VERSION = 1;
+
+// Fixed-size header of an obstacle set file, followed by 64-byte-aligned sections: the
+// mask words, the vertex count of each polygon and the vertices (x, y floats)
+struct ObstacleSetHeader {
+    char magic[8];                  // "BLWOBST" + '\0'
+    uint32_t version;               // OBSTACLE_SET_VERSION
+    uint32_t byte_order_mark;       // 0x01020304 as written by the saving host
+    int32_t width;                  // Grid cells in X
+    int32_t height;                 // Grid cells in Y
+    int32_t ordering;               // CellOrdering of the mask
+    float cell_size;                // Cell size in world units
+    uint64_t cell_count;            // width * height
+    uint64_t polygon_count;         // Obstacle polygons
+    uint64_t vertex_count;          // Total vertices
+    uint64_t checksum;              // section_checksum() chained over the sections
+};
+
+struct ObstacleSetSections {
+    uint64_t mask;
+    uint64_t polygon_sizes;
+    uint64_t vertices;
+    uint64_t file_size;
+};
+
+static ObstacleSetSections set_sections(const ObstacleSetHeader& header) {
+    ObstacleSetSections s;
+    s.mask = align_section(sizeof(ObstacleSetHeader));
+    const uint64_t words = (header.cell_count + ObstacleMask::WORD_BITS - 1) / ObstacleMask::WORD_BITS;
+    s.polygon_sizes = align_section(s.mask + words * sizeof(uint64_t));
+    s.vertices = align_section(s.polygon_sizes + header.polygon_count * sizeof(uint32_t));
+    s.file_size = s.vertices + header.vertex_count * 2 * sizeof(float);
+    return s;
+}
+
+static uint64_t set_checksum(const uint8_t* mask, const uint8_t* polygon_sizes, const uint8_t* vertices,
+                             const ObstacleSetHeader& header) {
+    const uint64_t words = (header.cell_count + ObstacleMask::WORD_BITS - 1) / ObstacleMask::WORD_BITS;
+    uint64_t h = section_checksum(mask, words * sizeof(uint64_t));
+    h = section_checksum(polygon_sizes, header.polygon_count * sizeof(uint32_t), h);
+    return section_checksum(vertices, header.vertex_count * 2 * sizeof(float), h);
+}
+
+ObstacleSet::ObstacleSet(ObstacleManager geometry, ObstacleMask mask, int width, int height, CellOrdering ordering,
+                         float cell_size)
+    : geometry(std::move(geometry)), mask(std::move(mask)), grid_width(width), grid_height(height),
+      ordering(ordering), cell_size(cell_size) {}
+
+ObstacleSet::ObstacleSet(ObstacleManager geometry, const LatticeLayout& layout, float cell_size)
+    : geometry(std::move(geometry)), grid_width(layout.get_width()), grid_height(layout.get_height()),
+      ordering(layout.get_ordering()), cell_size(cell_size) {
+    rasterize_obstacles(this->geometry, layout, cell_size, mask);
+}
+
+ObstacleSet::ObstacleSet(ObstacleManager geometry, ObstacleMask mask, const LatticeLayout& layout, float cell_size)
+    : ObstacleSet(std::move(geometry), std::move(mask), layout.get_width(), layout.get_height(),
+                  layout.get_ordering(), cell_size) {
+    if (this->mask.size() != static_cast<size_t>(layout.get_cell_count())) {
+        throw std::invalid_argument("Obstacle mask size does not match the lattice");
+    }
+}
+
+bool ObstacleSet::matches(const LatticeLayout& layout, float cell_size) const {
+    return grid_width == layout.get_width() && grid_height == layout.get_height() &&
+           ordering == layout.get_ordering() && this->cell_size == cell_size;
+}
+
+bool ObstacleSet::save(const std::string& filename) const {
+    TRACE_SCOPE("save obstacle set", "io");
+    std::vector<uint32_t> polygon_sizes;
+    std::vector<float> vertices;
+    for (const auto& obstacle : geometry.get_obstacles()) {
+        polygon_sizes.push_back(static_cast<uint32_t>(obstacle.vertices.size()));
+        for (const auto& v : obstacle.vertices) {
+            vertices.push_back(v.x);
+            vertices.push_back(v.y);
+        }
+    }
+
+    ObstacleSetHeader header = {};
+    std::memcpy(header.magic, OBSTACLE_SET_MAGIC, sizeof(header.magic));
+    header.version = OBSTACLE_SET_VERSION;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.width = grid_width;
+    header.height = grid_height;
+    header.ordering = static_cast<int32_t>(ordering);
+    header.cell_size = cell_size;
+    header.cell_count = mask.size();
+    header.polygon_count = polygon_sizes.size();
+    header.vertex_count = vertices.size() / 2;
+    header.checksum = set_checksum(reinterpret_cast<const uint8_t*>(mask.words()),
+                                   reinterpret_cast<const uint8_t*>(polygon_sizes.data()),
+                                   reinterpret_cast<const uint8_t*>(vertices.data()), header);
+    const ObstacleSetSections sections = set_sections(header);
+
+    // Processes that mapped the previous file keep their pages; new ones see the new file
+    return write_sections(filename, {
+        {0, &header, sizeof(header)},
+        {sections.mask, mask.words(), mask.word_count() * sizeof(uint64_t)},
+        {sections.polygon_sizes, polygon_sizes.data(), polygon_sizes.size() * sizeof(uint32_t)},
+        {sections.vertices, vertices.data(), vertices.size() * sizeof(float)},
+    }, "ObstacleSet");
+}
+
+std::shared_ptr<const ObstacleSet> ObstacleSet::load(const std::string& filename) {
+    TRACE_SCOPE("load obstacle set", "io");
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) {
+        std::cerr << "[ERROR] ObstacleSet: Failed to map file - " << filename << std::endl;
+        return nullptr;
+    }
+    ObstacleSetHeader header;
+    if (file->size() < sizeof(header)) {
+        std::cerr << "[ERROR] ObstacleSet: File too short - " << filename << std::endl;
+        return nullptr;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, OBSTACLE_SET_MAGIC, sizeof(OBSTACLE_SET_MAGIC)) != 0 ||
+        header.byte_order_mark != BYTE_ORDER_MARK || header.version != OBSTACLE_SET_VERSION) {
+        std::cerr << "[ERROR] ObstacleSet: Not an obstacle set of this version and byte order - " << filename << std::endl;
+        return nullptr;
+    }
+    if (header.width <= 0 || header.height <= 0 ||
+        header.cell_count != static_cast<uint64_t>(header.width) * static_cast<uint64_t>(header.height) ||
+        header.ordering < 0 || header.ordering > static_cast<int32_t>(CellOrdering::Morton)) {
+        std::cerr << "[ERROR] ObstacleSet: Invalid grid description - " << filename << std::endl;
+        return nullptr;
+    }
+    const ObstacleSetSections sections = set_sections(header);
+    if (file->size() < sections.file_size) {
+        std::cerr << "[ERROR] ObstacleSet: File truncated - " << filename << std::endl;
+        return nullptr;
+    }
+    const uint8_t* base = file->data();
+    if (set_checksum(base + sections.mask, base + sections.polygon_sizes, base + sections.vertices, header) !=
+        header.checksum) {
+        std::cerr << "[ERROR] ObstacleSet: Checksum mismatch (corrupt file) - " << filename << std::endl;
+        return nullptr;
+    }
+
+    // Polygons are small and copied; the mask stays in the mapping (64-byte aligned section)
+    ObstacleManager geometry;
+    const uint32_t* polygon_sizes = reinterpret_cast<const uint32_t*>(base + sections.polygon_sizes);
+    const float* vertices = reinterpret_cast<const float*>(base + sections.vertices);
+    size_t vertex = 0;
+    for (uint64_t p = 0; p < header.polygon_count; ++p) {
+        std::vector<Vec2> polygon;
+        for (uint32_t k = 0; k < polygon_sizes[p] && vertex < header.vertex_count; ++k, ++vertex) {
+            polygon.emplace_back(vertices[vertex * 2], vertices[vertex * 2 + 1]);
+        }
+        geometry.add_obstacle_from_vertices(polygon);
+    }
+    const uint64_t* words = reinterpret_cast<const uint64_t*>(base + sections.mask);
+    ObstacleMask mask = ObstacleMask::view(words, header.cell_count, file);
+
+    std::cout << "[DEBUG] ObstacleSet: Mapped " << header.width << "x" << header.height << " mask with "
+              << header.polygon_count << " polygons from " << filename << std::endl;
+    return std::shared_ptr<const ObstacleSet>(new ObstacleSet(std::move(geometry), std::move(mask), header.width,
+                                                              header.height, static_cast<CellOrdering>(header.ordering),
+                                                              header.cell_size));
+}
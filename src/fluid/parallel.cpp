@@ -0,0 +1,185 @@
+#include <parallel.hpp>
+#include <trace.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sched.h>
+#endif
+
+// CPUs the process may run on, ascending (empty where affinity is unsupported)
+static std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+#if defined(_WIN32)
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); ++cpu) {
+            if (process_mask & (DWORD_PTR(1) << cpu)) cpus.push_back(cpu);
+        }
+    }
+#elif defined(__linux__)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+// Restrict the calling thread to one CPU
+static bool bind_current_thread(int cpu) {
+#if defined(_WIN32)
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t target;
+    CPU_ZERO(&target);
+    CPU_SET(cpu, &target);
+    return sched_setaffinity(0, sizeof(target), &target) == 0; // 0 = calling thread
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+// Thread 'index' of 'count' gets allowed CPU index * cpus / count, so the threads spread over
+// all sockets while neighbouring threads (neighbouring row bands) share one
+static bool pin_current_thread(int index, int count) {
+    const std::vector<int> cpus = allowed_cpus();
+    if (cpus.empty()) return false;
+    const size_t slot = static_cast<size_t>(count) <= cpus.size()
+        ? static_cast<size_t>(index) * cpus.size() / static_cast<size_t>(count)
+        : static_cast<size_t>(index) % cpus.size();
+    return bind_current_thread(cpus[slot]);
+}
+
+ThreadPool::ThreadPool(int threads, ThreadPlacement placement)
+    : placement(placement), thread_count(threads), job(nullptr), job_count(0), job_grain(1), job_chunks(0),
+      next_chunk(0), generation(0), busy(0), stopping(false) {
+    if (thread_count <= 0) thread_count = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    // Pinned pools run every chunk on their own threads: the caller keeps its affinity
+    const int first = (placement == ThreadPlacement::Pinned) ? 0 : 1;
+    for (int i = first; i < thread_count; ++i) {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto& worker : workers) worker.join();
+}
+
+void ThreadPool::run_chunks(int index) {
+    // One span per thread and job: uneven spans in the trace show load imbalance
+    TRACE_SCOPE("pool chunks", "pool");
+    if (placement != ThreadPlacement::Dynamic) {
+        // Same block of chunks for thread 'index' in every job with the same count and grain
+        const size_t threads = static_cast<size_t>(thread_count);
+        const size_t first = job_chunks * static_cast<size_t>(index) / threads;
+        const size_t last = job_chunks * static_cast<size_t>(index + 1) / threads;
+        for (size_t chunk = first; chunk < last; ++chunk) {
+            size_t begin = chunk * job_grain;
+            (*job)(begin, std::min(job_count, begin + job_grain));
+        }
+        return;
+    }
+    while (true) {
+        size_t chunk = next_chunk.fetch_add(1, std::memory_order_relaxed);
+        if (chunk >= job_chunks) break;
+        size_t begin = chunk * job_grain;
+        (*job)(begin, std::min(job_count, begin + job_grain));
+    }
+}
+
+void ThreadPool::worker_loop(int index) {
+    if (placement == ThreadPlacement::Pinned && !pin_current_thread(index, thread_count)) {
+        std::cerr << "[WARNING] ThreadPool: Cannot pin thread " << index << " to a CPU" << std::endl;
+    }
+
+    unsigned long seen = 0;
+    bool named = false;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        work_ready.wait(lock, [this, seen] { return stopping || generation != seen; });
+        if (stopping) break;
+        seen = generation;
+
+        lock.unlock();
+        // Named once tracing is on: a trace buffer is kept until exit, and pools come and go
+        if (!named && Tracer::is_enabled()) {
+            const std::string name = "pool worker " + std::to_string(index);
+            Tracer::set_thread_name(name.c_str());
+            named = true;
+        }
+        run_chunks(index);
+        lock.lock();
+        if (--busy == 0) work_done.notify_one();
+    }
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    if (count == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    const size_t chunks = chunk_count(count, grain);
+
+    // Nothing to share: run inline without touching the workers (a single chunk belongs to
+    // the caller under a static placement too, but to a worker when pinned)
+    if (workers.empty() || (chunks == 1 && placement != ThreadPlacement::Pinned)) {
+        for (size_t begin = 0; begin < count; begin += grain) {
+            fn(begin, std::min(count, begin + grain));
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        job_count = count;
+        job_grain = grain;
+        job_chunks = chunks;
+        next_chunk.store(0, std::memory_order_relaxed);
+        busy = static_cast<int>(workers.size());
+        generation++;
+    }
+    work_ready.notify_all();
+
+    if (placement != ThreadPlacement::Pinned) run_chunks(0);
+
+    // Workers may still be finishing their last chunk
+    std::unique_lock<std::mutex> lock(mutex);
+    work_done.wait(lock, [this] { return busy == 0; });
+    job = nullptr;
+}
+
+bool placement_from_name(const std::string& name, ThreadPlacement& out) {
+    if (name == "dynamic") out = ThreadPlacement::Dynamic;
+    else if (name == "static") out = ThreadPlacement::Static;
+    else if (name == "pinned") out = ThreadPlacement::Pinned;
+    else return false;
+    return true;
+}
+
+const char* placement_name(ThreadPlacement placement) {
+    switch (placement) {
+        case ThreadPlacement::Static: return "static";
+        case ThreadPlacement::Pinned: return "pinned";
+        default: return "dynamic";
+    }
+}
@@ -0,0 +1,19 @@
+#include <population_storage.hpp>
+
+bool precision_from_name(const std::string& name, PopulationPrecision& out) {
+    if (name == "fp64") out = PopulationPrecision::FP64;
+    else if (name == "fp32") out = PopulationPrecision::FP32;
+    else if (name == "fp16") out = PopulationPrecision::FP16;
+    else if (name == "bf16") out = PopulationPrecision::BF16;
+    else return false;
+    return true;
+}
+
+const char* precision_name(PopulationPrecision precision) {
+    switch (precision) {
+        case PopulationPrecision::FP64: return "fp64";
+        case PopulationPrecision::FP16: return "fp16";
+        case PopulationPrecision::BF16: return "bf16";
+        default: return "fp32";
+    }
+}
@@ -0,0 +1,89 @@
+#include <profiler.hpp>
+
+#include <cstdio>
+
+PhaseProfiler::PhaseProfiler()
+    : enabled(true), steps(0), cells_per_step(0), bytes_per_cell(0),
+      window_start(std::chrono::steady_clock::now()) {
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        phase_ns[i].store(0, std::memory_order_relaxed);
+        phase_calls[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void PhaseProfiler::configure(uint64_t cells, uint64_t bytes) {
+    cells_per_step = cells;
+    bytes_per_cell = bytes;
+}
+
+void PhaseProfiler::restart_window() {
+    window_start = std::chrono::steady_clock::now();
+    steps.store(0, std::memory_order_relaxed);
+}
+
+double PhaseProfiler::window_seconds() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - window_start).count();
+}
+
+PhaseProfiler::Window PhaseProfiler::collect_window() {
+    Window window;
+    auto now = std::chrono::steady_clock::now();
+    window.seconds = std::chrono::duration<double>(now - window_start).count();
+    window_start = now;
+
+    window.steps = steps.exchange(0, std::memory_order_relaxed);
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        window.ns[i] = phase_ns[i].exchange(0, std::memory_order_relaxed);
+        window.calls[i] = phase_calls[i].exchange(0, std::memory_order_relaxed);
+    }
+    return window;
+}
+
+void PhaseProfiler::report(std::ostream& out) {
+    Window window = collect_window();
+    const double seconds = window.seconds;
+    const uint64_t window_steps = window.steps;
+    const uint64_t* ns = window.ns;
+    const uint64_t* calls = window.calls;
+
+    uint64_t solver_ns = 0;
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        if (i != static_cast<int>(ProfilePhase::Render) && i != static_cast<int>(ProfilePhase::Tree)) solver_ns += ns[i];
+    }
+
+    char line[160];
+    double updates = static_cast<double>(window_steps) * cells_per_step;
+    double mlups = seconds > 0.0 ? updates / seconds / 1e6 : 0.0;
+    double gbps = seconds > 0.0 ? updates * bytes_per_cell / seconds / 1e9 : 0.0;
+    std::snprintf(line, sizeof(line), "[PROFILE] %llu steps in %.2f s: %.2f MLUPS, ~%.2f GB/s effective bandwidth\n",
+                  static_cast<unsigned long long>(window_steps), seconds, mlups, gbps);
+    out << line;
+
+    // Step phases as time per step and share of the timed solver work; tree and render per call
+    for (int i = 0; i < PHASE_COUNT; ++i) {
+        if (calls[i] == 0) continue;
+        ProfilePhase phase = static_cast<ProfilePhase>(i);
+        if (phase == ProfilePhase::Render || phase == ProfilePhase::Tree) {
+            std::snprintf(line, sizeof(line), "[PROFILE]   %-10s %8.3f ms/call (%llu calls)\n", phase_name(phase),
+                          ns[i] / 1e6 / calls[i], static_cast<unsigned long long>(calls[i]));
+        } else {
+            double per_step = window_steps ? ns[i] / 1e6 / window_steps : ns[i] / 1e6;
+            std::snprintf(line, sizeof(line), "[PROFILE]   %-10s %8.3f ms/step %5.1f%%\n", phase_name(phase),
+                          per_step, solver_ns ? 100.0 * ns[i] / solver_ns : 0.0);
+        }
+        out << line;
+    }
+    out.flush();
+}
+
+const char* PhaseProfiler::phase_name(ProfilePhase phase) {
+    switch (phase) {
+        case ProfilePhase::Collision: return "collision";
+        case ProfilePhase::Streaming: return "streaming";
+        case ProfilePhase::Boundary:  return "boundary";
+        case ProfilePhase::Density:   return "density";
+        case ProfilePhase::Tree:      return "tree";
+        case ProfilePhase::Render:    return "render";
+        default:                      return "unknown";
+    }
+}
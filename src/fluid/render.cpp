@@ -4,17 +4,142 @@
 
 #include <iostream>
 #include <cmath>
-#include <cstring>
+
+// 5x7 pixel font for printable ASCII 32 (space) to 126 (~).
+// One byte per column (5 columns per glyph), bit 0 = top row.
+static const int FONT_FIRST_CHAR = 32;
+static const int FONT_GLYPH_COUNT = 95;
+static const uint8_t FONT_5X7[FONT_GLYPH_COUNT][5] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x00, 0x00, 0x5F, 0x00, 0x00}, // '!'
+    {0x00, 0x07, 0x00, 0x07, 0x00}, // '"'
+    {0x14, 0x7F, 0x14, 0x7F, 0x14}, // '#'
+    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, // '$'
+    {0x23, 0x13, 0x08, 0x64, 0x62}, // '%'
+    {0x36, 0x49, 0x55, 0x22, 0x50}, // '&'
+    {0x00, 0x05, 0x03, 0x00, 0x00}, // '''
+    {0x00, 0x1C, 0x22, 0x41, 0x00}, // '('
+    {0x00, 0x41, 0x22, 0x1C, 0x00}, // ')'
+    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, // '*'
+    {0x08, 0x08, 0x3E, 0x08, 0x08}, // '+'
+    {0x00, 0x50, 0x30, 0x00, 0x00}, // ','
+    {0x08, 0x08, 0x08, 0x08, 0x08}, // '-'
+    {0x00, 0x60, 0x60, 0x00, 0x00}, // '.'
+    {0x20, 0x10, 0x08, 0x04, 0x02}, // '/'
+    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // '0'
+    {0x00, 0x42, 0x7F, 0x40, 0x00}, // '1'
+    {0x42, 0x61, 0x51, 0x49, 0x46}, // '2'
+    {0x21, 0x41, 0x45, 0x4B, 0x31}, // '3'
+    {0x18, 0x14, 0x12, 0x7F, 0x10}, // '4'
+    {0x27, 0x45, 0x45, 0x45, 0x39}, // '5'
+    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // '6'
+    {0x01, 0x71, 0x09, 0x05, 0x03}, // '7'
+    {0x36, 0x49, 0x49, 0x49, 0x36}, // '8'
+    {0x06, 0x49, 0x49, 0x29, 0x1E}, // '9'
+    {0x00, 0x36, 0x36, 0x00, 0x00}, // ':'
+    {0x00, 0x56, 0x36, 0x00, 0x00}, // ';'
+    {0x08, 0x14, 0x22, 0x41, 0x00}, // '<'
+    {0x14, 0x14, 0x14, 0x14, 0x14}, // '='
+    {0x00, 0x41, 0x22, 0x14, 0x08}, // '>'
+    {0x02, 0x01, 0x51, 0x09, 0x06}, // '?'
+    {0x32, 0x49, 0x79, 0x41, 0x3E}, // '@'
+    {0x7E, 0x11, 0x11, 0x11, 0x7E}, // 'A'
+    {0x7F, 0x49, 0x49, 0x49, 0x36}, // 'B'
+    {0x3E, 0x41, 0x41, 0x41, 0x22}, // 'C'
+    {0x7F, 0x41, 0x41, 0x22, 0x1C}, // 'D'
+    {0x7F, 0x49, 0x49, 0x49, 0x41}, // 'E'
+    {0x7F, 0x09, 0x09, 0x09, 0x01}, // 'F'
+    {0x3E, 0x41, 0x49, 0x49, 0x7A}, // 'G'
+    {0x7F, 0x08, 0x08, 0x08, 0x7F}, // 'H'
+    {0x00, 0x41, 0x7F, 0x41, 0x00}, // 'I'
+    {0x20, 0x40, 0x41, 0x3F, 0x01}, // 'J'
+    {0x7F, 0x08, 0x14, 0x22, 0x41}, // 'K'
+    {0x7F, 0x40, 0x40, 0x40, 0x40}, // 'L'
+    {0x7F, 0x02, 0x0C, 0x02, 0x7F}, // 'M'
+    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // 'N'
+    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // 'O'
+    {0x7F, 0x09, 0x09, 0x09, 0x06}, // 'P'
+    {0x3E, 0x41, 0x51, 0x21, 0x5E}, // 'Q'
+    {0x7F, 0x09, 0x19, 0x29, 0x46}, // 'R'
+    {0x46, 0x49, 0x49, 0x49, 0x31}, // 'S'
+    {0x01, 0x01, 0x7F, 0x01, 0x01}, // 'T'
+    {0x3F, 0x40, 0x40, 0x40, 0x3F}, // 'U'
+    {0x1F, 0x20, 0x40, 0x20, 0x1F}, // 'V'
+    {0x3F, 0x40, 0x38, 0x40, 0x3F}, // 'W'
+    {0x63, 0x14, 0x08, 0x14, 0x63}, // 'X'
+    {0x07, 0x08, 0x70, 0x08, 0x07}, // 'Y'
+    {0x61, 0x51, 0x49, 0x45, 0x43}, // 'Z'
+    {0x00, 0x7F, 0x41, 0x41, 0x00}, // '['
+    {0x02, 0x04, 0x08, 0x10, 0x20}, // '\'
+    {0x00, 0x41, 0x41, 0x7F, 0x00}, // ']'
+    {0x04, 0x02, 0x01, 0x02, 0x04}, // '^'
+    {0x40, 0x40, 0x40, 0x40, 0x40}, // '_'
+    {0x00, 0x01, 0x02, 0x04, 0x00}, // '`'
+    {0x20, 0x54, 0x54, 0x54, 0x78}, // 'a'
+    {0x7F, 0x48, 0x44, 0x44, 0x38}, // 'b'
+    {0x38, 0x44, 0x44, 0x44, 0x20}, // 'c'
+    {0x38, 0x44, 0x44, 0x48, 0x7F}, // 'd'
+    {0x38, 0x54, 0x54, 0x54, 0x18}, // 'e'
+    {0x08, 0x7E, 0x09, 0x01, 0x02}, // 'f'
+    {0x0C, 0x52, 0x52, 0x52, 0x3E}, // 'g'
+    {0x7F, 0x08, 0x04, 0x04, 0x78}, // 'h'
+    {0x00, 0x44, 0x7D, 0x40, 0x00}, // 'i'
+    {0x20, 0x40, 0x44, 0x3D, 0x00}, // 'j'
+    {0x7F, 0x10, 0x28, 0x44, 0x00}, // 'k'
+    {0x00, 0x41, 0x7F, 0x40, 0x00}, // 'l'
+    {0x7C, 0x04, 0x18, 0x04, 0x78}, // 'm'
+    {0x7C, 0x08, 0x04, 0x04, 0x78}, // 'n'
+    {0x38, 0x44, 0x44, 0x44, 0x38}, // 'o'
+    {0x7C, 0x14, 0x14, 0x14, 0x08}, // 'p'
+    {0x08, 0x14, 0x14, 0x18, 0x7C}, // 'q'
+    {0x7C, 0x08, 0x04, 0x04, 0x08}, // 'r'
+    {0x48, 0x54, 0x54, 0x54, 0x20}, // 's'
+    {0x04, 0x3F, 0x44, 0x40, 0x20}, // 't'
+    {0x3C, 0x40, 0x40, 0x20, 0x7C}, // 'u'
+    {0x1C, 0x20, 0x40, 0x20, 0x1C}, // 'v'
+    {0x3C, 0x40, 0x30, 0x40, 0x3C}, // 'w'
+    {0x44, 0x28, 0x10, 0x28, 0x44}, // 'x'
+    {0x0C, 0x50, 0x50, 0x50, 0x3C}, // 'y'
+    {0x44, 0x64, 0x54, 0x4C, 0x44}, // 'z'
+    {0x00, 0x08, 0x36, 0x41, 0x00}, // '{'
+    {0x00, 0x00, 0x7F, 0x00, 0x00}, // '|'
+    {0x00, 0x41, 0x36, 0x08, 0x00}, // '}'
+    {0x08, 0x04, 0x08, 0x10, 0x08}, // '~'
+};
+
+// Glyph atlas layout: 16 x 6 cells of 6 x 8 texels (5 x 7 glyph + 1 texel gap)
+static const int ATLAS_COLUMNS = 16;
+static const int ATLAS_ROWS = 6;
+static const int ATLAS_CELL_W = 6;
+static const int ATLAS_CELL_H = 8;
+static const int ATLAS_WIDTH = ATLAS_COLUMNS * ATLAS_CELL_W;
+static const int ATLAS_HEIGHT = ATLAS_ROWS * ATLAS_CELL_H;
 
 // Constructor: Initialize members in SAME ORDER as declared in render.hpp (fixes reorder warning)
-Render::Render(BLWFluid& fluid, int win_width, int win_height, const char* title)
+Render::Render(BLWFluid& fluid, TripleBuffer<FieldSnapshot>& snapshot_buffer,
+               int win_width, int win_height, const char* title)
     : window(nullptr),          // 1. GLFWwindow* window
       window_width(win_width),  // 2. int window_width
       window_height(win_height),// 3. int window_height
       fluid(fluid),             // 4. BLWFluid& fluid
+      snapshots(snapshot_buffer),
       last_time(0.0),
       frame_count(0),
-      fps(0.0) {
+      fps(0.0),
+      last_step(0),
+      sim_rate(0.0f),
+      fluid_texture(0),
+      texture_width(0),
+      texture_height(0),
+      use_persistent_pbo(false),
+      pixel_buffer(0),
+      pixel_buffer_ptr(nullptr),
+      pixel_fences{},
+      pixel_region(0),
+      colormap(Palette::BlueGreenRed, 0.8f, 1.2f),
+      obstacle_texture(0),
+      obstacle_revision(0),
+      glyph_atlas(0) {
     
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -30,9 +155,17 @@ Render::Render(BLWFluid& fluid, int win_width, int win_height, const char* title
 
     glfwMakeContextCurrent(window);
     setup_opengl();
+    build_glyph_atlas();
+
+    use_persistent_pbo = pbo.load(window);
+    std::cout << "[DEBUG] Render: Fluid upload via "
+              << (use_persistent_pbo ? "persistently mapped PBO" : "glTexSubImage2D") << std::endl;
 }
 
 Render::~Render() {
+    release_fluid_texture(); // GL objects must go before the context
+    glDeleteTextures(1, &obstacle_texture);
+    glDeleteTextures(1, &glyph_atlas);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -52,167 +185,254 @@ void Render::update_fps() {
     double current_time = glfwGetTime();
     frame_count++;
     if (current_time - last_time >= 1.0) {
+        long step = snapshots.read_buffer().step;
         fps = frame_count / (current_time - last_time);
+        sim_rate = (step - last_step) / (current_time - last_time);
         frame_count = 0;
         last_time = current_time;
+        last_step = step;
     }
 }
 
-// Custom text rendering: Draw single ASCII character (5x7 font, no external dependencies)
-void Render::draw_char(float x, float y, char c, float scale) {
-    // 5x7 pixel font for ASCII 32 (space) to 126 (~)
-    const bool font[128][7][5] = {
-        // ASCII 32 (space)
-        {{0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 48 (0)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 49 (1)
-        {{0,0,1,0,0}, {0,1,1,0,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 50 (2)
-        {{0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 51 (3)
-        {{0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 52 (4)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,1,0}, {0,0,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 53 (5)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 54 (6)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 55 (7)
-        {{0,1,1,1,0}, {0,0,0,1,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 56 (8)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 57 (9)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 65 (A)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 66 (B)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 67 (C)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 68 (D)
-        {{0,1,1,0,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 69 (E)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 70 (F)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 71 (G)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 72 (H)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 73 (I)
-        {{0,1,1,1,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 74 (J)
-        {{0,1,1,1,0}, {0,0,0,1,0}, {0,0,0,1,0}, {0,1,0,1,0}, {0,1,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 75 (K)
-        {{0,1,0,1,0}, {0,1,1,0,0}, {0,1,0,0,0}, {0,1,1,0,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 76 (L)
-        {{0,1,0,0,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 77 (M)
-        {{0,1,0,1,0}, {0,1,1,1,1}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 78 (N)
-        {{0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 79 (O)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 80 (P)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,0,0}, {0,1,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 81 (Q)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,1,1,0}, {0,1,1,0,1}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 82 (R)
-        {{0,1,1,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,1,0,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 83 (S)
-        {{0,1,1,1,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 84 (T)
-        {{0,1,1,1,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 85 (U)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 86 (V)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 87 (W)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 88 (X)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,0,1,0,0}, {0,1,0,1,0}, {0,1,0,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 89 (Y)
-        {{0,1,0,1,0}, {0,1,0,1,0}, {0,1,1,1,0}, {0,0,1,0,0}, {0,0,1,0,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 90 (Z)
-        {{0,1,1,1,0}, {0,0,0,1,0}, {0,0,1,0,0}, {0,1,0,0,0}, {0,1,1,1,0}, {0,0,0,0,0}, {0,0,0,0,0}},
-        // ASCII 97 (a) to 126 (~) - Add if needed, but basic UI only uses numbers/symbols
-        {{0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}, {0,0,0,0,0}}
-    };
-
-    // Only render printable ASCII characters (32-126)
-    if (c < 32 || c > 126) c = 32;
-
-    glPushMatrix();
-    glTranslatef(x, y, 0.0f);
-    glScalef(scale, scale, 1.0f);
-
-    // Draw each pixel of the character as a small quad
-    glColor3f(1.0f, 1.0f, 1.0f); // White text
-    for (int row = 0; row < 7; ++row) {
+// Build the glyph atlas texture once: white texels, alpha = glyph coverage
+void Render::build_glyph_atlas() {
+    std::vector<uint32_t> texels(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for (int g = 0; g < FONT_GLYPH_COUNT; ++g) {
+        int origin_x = (g % ATLAS_COLUMNS) * ATLAS_CELL_W;
+        int origin_y = (g / ATLAS_COLUMNS) * ATLAS_CELL_H;
         for (int col = 0; col < 5; ++col) {
-            if (font[(unsigned char)c][row][col]) {
-                float px = col * 2.0f;
-                float py = row * 2.0f;
-                glBegin(GL_QUADS);
-                glVertex2f(px, py);
-                glVertex2f(px + 2.0f, py);
-                glVertex2f(px + 2.0f, py + 2.0f);
-                glVertex2f(px, py + 2.0f);
-                glEnd();
+            for (int row = 0; row < 7; ++row) {
+                if (FONT_5X7[g][col] & (1 << row)) {
+                    texels[(origin_y + row) * ATLAS_WIDTH + origin_x + col] = 0xFFFFFFFFu;
+                }
             }
         }
     }
 
-    glPopMatrix();
+    glGenTextures(1, &glyph_atlas);
+    glBindTexture(GL_TEXTURE_2D, glyph_atlas);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Lay out a string as textured quads (x, y, u, v per vertex) into text_vertices.
+// Each font pixel covers 2 x 2 units before scaling; characters advance 12 units.
+void Render::layout_text(const std::string& text, float x, float y, float scale) {
+    text_vertices.clear();
+    text_vertices.reserve(text.size() * 16);
+
+    const float glyph_w = 10.0f * scale;
+    const float glyph_h = 14.0f * scale;
+    for (char ch : text) {
+        int c = static_cast<unsigned char>(ch);
+        if (c < FONT_FIRST_CHAR || c >= FONT_FIRST_CHAR + FONT_GLYPH_COUNT) c = ' ';
+        int g = c - FONT_FIRST_CHAR;
+
+        if (g != 0) { // Spaces only advance
+            float u0 = static_cast<float>((g % ATLAS_COLUMNS) * ATLAS_CELL_W) / ATLAS_WIDTH;
+            float v0 = static_cast<float>((g / ATLAS_COLUMNS) * ATLAS_CELL_H) / ATLAS_HEIGHT;
+            float u1 = u0 + 5.0f / ATLAS_WIDTH;
+            float v1 = v0 + 7.0f / ATLAS_HEIGHT;
+            const float quad[16] = {
+                x,           y,           u0, v0,
+                x + glyph_w, y,           u1, v0,
+                x + glyph_w, y + glyph_h, u1, v1,
+                x,           y + glyph_h, u0, v1
+            };
+            text_vertices.insert(text_vertices.end(), quad, quad + 16);
+        }
+        x += 12.0f * scale; // Advance x position for next character
+    }
+}
+
+// Draw the laid-out text with a single vertex array call
+void Render::draw_text() {
+    if (text_vertices.empty()) return;
+
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, glyph_atlas);
+    glColor3f(1.0f, 1.0f, 1.0f); // White text
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(2, GL_FLOAT, 4 * sizeof(float), text_vertices.data());
+    glTexCoordPointer(2, GL_FLOAT, 4 * sizeof(float), text_vertices.data() + 2);
+    glDrawArrays(GL_QUADS, 0, static_cast<GLsizei>(text_vertices.size() / 4));
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
+
+bool PixelBufferFunctions::load(GLFWwindow* window) {
+    GenBuffers = reinterpret_cast<PFNGLGENBUFFERSPROC>(glfwGetProcAddress("glGenBuffers"));
+    DeleteBuffers = reinterpret_cast<PFNGLDELETEBUFFERSPROC>(glfwGetProcAddress("glDeleteBuffers"));
+    BindBuffer = reinterpret_cast<PFNGLBINDBUFFERPROC>(glfwGetProcAddress("glBindBuffer"));
+    BufferStorage = reinterpret_cast<PFNGLBUFFERSTORAGEPROC>(glfwGetProcAddress("glBufferStorage"));
+    MapBufferRange = reinterpret_cast<PFNGLMAPBUFFERRANGEPROC>(glfwGetProcAddress("glMapBufferRange"));
+    UnmapBuffer = reinterpret_cast<PFNGLUNMAPBUFFERPROC>(glfwGetProcAddress("glUnmapBuffer"));
+    FenceSync = reinterpret_cast<PFNGLFENCESYNCPROC>(glfwGetProcAddress("glFenceSync"));
+    ClientWaitSync = reinterpret_cast<PFNGLCLIENTWAITSYNCPROC>(glfwGetProcAddress("glClientWaitSync"));
+    DeleteSync = reinterpret_cast<PFNGLDELETESYNCPROC>(glfwGetProcAddress("glDeleteSync"));
+
+    // Persistent mapping needs GL 4.4 or ARB_buffer_storage (fences are core since 3.2)
+    int major = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MAJOR);
+    int minor = glfwGetWindowAttrib(window, GLFW_CONTEXT_VERSION_MINOR);
+    bool has_storage = (major > 4 || (major == 4 && minor >= 4)) ||
+                       glfwExtensionSupported("GL_ARB_buffer_storage");
+
+    return has_storage && GenBuffers && DeleteBuffers && BindBuffer && BufferStorage &&
+           MapBufferRange && UnmapBuffer && FenceSync && ClientWaitSync && DeleteSync;
+}
+
+void Render::allocate_fluid_texture(int width, int height) {
+    release_fluid_texture();
+
+    glGenTextures(1, &fluid_texture);
+    glBindTexture(GL_TEXTURE_2D, fluid_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture_width = width;
+    texture_height = height;
+
+    size_t frame_bytes = static_cast<size_t>(width) * height * sizeof(uint32_t);
+    if (use_persistent_pbo) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        pbo.GenBuffers(1, &pixel_buffer);
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        pbo.BufferStorage(GL_PIXEL_UNPACK_BUFFER, frame_bytes * PBO_REGIONS, nullptr, flags);
+        pixel_buffer_ptr = static_cast<uint8_t*>(
+            pbo.MapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, frame_bytes * PBO_REGIONS, flags));
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (!pixel_buffer_ptr) {
+            std::cerr << "[WARNING] Render: Failed to map pixel buffer, falling back to glTexSubImage2D" << std::endl;
+            pbo.DeleteBuffers(1, &pixel_buffer);
+            pixel_buffer = 0;
+            use_persistent_pbo = false;
+        }
+    }
+    if (!use_persistent_pbo) {
+        rgba_pixels.resize(static_cast<size_t>(width) * height);
+    }
 }
 
-void Render::render_fluid() {
-    int grid_w = fluid.get_grid_width();
-    int grid_h = fluid.get_grid_height();
-    float cell_size = fluid.get_cell_size();
-    const auto& cells = fluid.get_cells();
-
-    for (int y = 0; y < grid_h; ++y) {
-        for (int x = 0; x < grid_w; ++x) {
-            int idx = y * grid_w + x;
-            const auto& cell = cells[idx];
-
-            if (cell.is_obstacle) continue;
-
-            // Color based on density (blue → green → red gradient)
-            float density_norm = std::clamp(cell.density, 0.8f, 1.2f);
-            float r = std::min(1.0f, (density_norm - 0.8f) * 5.0f);
-            float b = std::min(1.0f, (1.2f - density_norm) * 5.0f);
-            float g = 0.2f + (0.6f * (1.0f - fabs(density_norm - 1.0f) * 5.0f));
-
-            glColor3f(r, g, b);
-            glBegin(GL_QUADS);
-            glVertex2f(x * cell_size, y * cell_size);
-            glVertex2f((x+1) * cell_size, y * cell_size);
-            glVertex2f((x+1) * cell_size, (y+1) * cell_size);
-            glVertex2f(x * cell_size, (y+1) * cell_size);
-            glEnd();
+void Render::release_fluid_texture() {
+    if (pixel_buffer) {
+        for (GLsync& fence : pixel_fences) {
+            if (fence) pbo.DeleteSync(fence);
+            fence = nullptr;
         }
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        pbo.UnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        pbo.DeleteBuffers(1, &pixel_buffer);
+        pixel_buffer = 0;
+        pixel_buffer_ptr = nullptr;
+    }
+    if (fluid_texture) {
+        glDeleteTextures(1, &fluid_texture);
+        fluid_texture = 0;
     }
+    texture_width = 0;
+    texture_height = 0;
 }
 
-void Render::render_obstacles() {
-    // Render obstacles as black polygons
-    glColor3f(0.0f, 0.0f, 0.0f);
-    const auto& cells = fluid.get_cells();
-    float cell_size = fluid.get_cell_size();
-
-    for (const auto& cell : cells) {
-        if (cell.is_obstacle) {
-            glBegin(GL_QUADS);
-            glVertex2f(cell.pos.x, cell.pos.y);
-            glVertex2f(cell.pos.x + cell_size, cell.pos.y);
-            glVertex2f(cell.pos.x + cell_size, cell.pos.y + cell_size);
-            glVertex2f(cell.pos.x, cell.pos.y + cell_size);
-            glEnd();
+void Render::upload_fluid_texture(const FieldSnapshot& snapshot) {
+    if (snapshot.width != texture_width || snapshot.height != texture_height) {
+        allocate_fluid_texture(snapshot.width, snapshot.height);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, fluid_texture);
+    if (use_persistent_pbo) {
+        // Write straight into the next ring region once the GPU is done with it
+        size_t frame_bytes = static_cast<size_t>(texture_width) * texture_height * sizeof(uint32_t);
+        GLsync& fence = pixel_fences[pixel_region];
+        if (fence) {
+            pbo.ClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+            pbo.DeleteSync(fence);
+            fence = nullptr;
         }
+
+        size_t offset = frame_bytes * pixel_region;
+        colormap.map_field(snapshot.density.data(), snapshot.obstacle.words(), snapshot.density.size(),
+                           reinterpret_cast<uint32_t*>(pixel_buffer_ptr + offset));
+
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, pixel_buffer);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture_width, texture_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        reinterpret_cast<const void*>(offset));
+        pbo.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        fence = pbo.FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        pixel_region = (pixel_region + 1) % PBO_REGIONS;
+    } else {
+        colormap.map_field(snapshot.density.data(), snapshot.obstacle.words(), snapshot.density.size(),
+                           rgba_pixels.data());
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture_width, texture_height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        rgba_pixels.data());
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Render::render_fluid(const FieldSnapshot& snapshot) {
+    upload_fluid_texture(snapshot);
+
+    // Whole field as one textured quad (texture row 0 = grid row y = 0 = top of the window)
+    float w = snapshot.width * snapshot.cell_size;
+    float h = snapshot.height * snapshot.cell_size;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, fluid_texture);
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, 0.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex2f(w, 0.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex2f(w, h);
+    glTexCoord2f(0.0f, 1.0f); glVertex2f(0.0f, h);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
+}
+
+// Rebuild the obstacle texture from the mask, only when the solver reports a new revision
+void Render::update_obstacle_texture(const FieldSnapshot& snapshot) {
+    if (obstacle_texture && snapshot.obstacle_revision == obstacle_revision) return;
+
+    std::vector<uint32_t> texels(snapshot.obstacle.size(), 0u); // Fluid stays transparent
+    snapshot.obstacle.for_each_obstacle(0, texels.size(), [&texels](size_t i) { texels[i] = pack_rgba(0, 0, 0); });
+
+    if (!obstacle_texture) glGenTextures(1, &obstacle_texture);
+    glBindTexture(GL_TEXTURE_2D, obstacle_texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, snapshot.width, snapshot.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 texels.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+    obstacle_revision = snapshot.obstacle_revision;
+}
+
+void Render::render_obstacles(const FieldSnapshot& snapshot) {
+    update_obstacle_texture(snapshot);
+
+    // Render obstacles as black cells: one quad over the cached mask texture
+    float w = snapshot.width * snapshot.cell_size;
+    float h = snapshot.height * snapshot.cell_size;
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, obstacle_texture);
+    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, 0.0f);
+    glTexCoord2f(1.0f, 0.0f); glVertex2f(w, 0.0f);
+    glTexCoord2f(1.0f, 1.0f); glVertex2f(w, h);
+    glTexCoord2f(0.0f, 1.0f); glVertex2f(0.0f, h);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDisable(GL_TEXTURE_2D);
 }
 
 void Render::render_ui() {
@@ -220,22 +440,20 @@ void Render::render_ui() {
 
     // Render FPS and parameters (fix: %u for size_t obstacle count)
     char text[256];
-    snprintf(text, sizeof(text), "FPS: %.1f | Grid: %dx%d | Viscosity: %.4f | Obstacles: %u",
+    snprintf(text, sizeof(text), "FPS: %.1f | Sim: %.0f steps/s | Grid: %dx%d | Viscosity: %.4f | Obstacles: %u",
              fps,
+             sim_rate,
              fluid.get_grid_width(),
              fluid.get_grid_height(),
              fluid.get_viscosity(),
              static_cast<unsigned int>(fluid.get_obstacle_count())); // Cast to match %u
 
-    // Draw text at bottom-left (y = 20 to avoid clipping)
-    float x = 10.0f;
-    float y = 20.0f;
-    float scale = 1.5f;
-
-    for (size_t i = 0; i < strlen(text); ++i) {
-        draw_char(x, y, text[i], scale);
-        x += 12.0f * scale; // Advance x position for next character
+    // Re-layout only when the text changed (the values refresh once per second)
+    if (hud_text != text) {
+        hud_text = text;
+        layout_text(hud_text, 10.0f, 20.0f, 1.5f); // y = 20 to avoid clipping
     }
+    draw_text();
 }
 
 void Render::process_input() {
@@ -245,9 +463,15 @@ void Render::process_input() {
 }
 
 void Render::render() {
+    PhaseProfiler::Scope timer(fluid.get_profiler(), ProfilePhase::Render);
+    snapshots.update(); // Never blocks: keeps the previous snapshot if the solver has not published
+    const FieldSnapshot& snapshot = snapshots.read_buffer();
+
     glClear(GL_COLOR_BUFFER_BIT);
-    render_obstacles();
-    render_fluid();
+    if (snapshot.width > 0) {
+        render_obstacles(snapshot);
+        render_fluid(snapshot);
+    }
     render_ui();
 }
 
@@ -263,6 +487,19 @@ void Render::poll_events() {
     glfwPollEvents();
 }
 
+void Render::wait_events(double timeout) {
+    glfwWaitEventsTimeout(timeout);
+}
+
+void Render::set_colormap(Palette palette, float range_min, float range_max) {
+    colormap.set_palette(palette);
+    colormap.set_range(range_min, range_max); // Obstacle cells stay transparent (masked color 0)
+}
+
 float Render::get_current_fps() const {
     return fps;
+}
+
+float Render::get_sim_rate() const {
+    return sim_rate;
 }
\ No newline at end of file
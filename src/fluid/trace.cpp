@@ -0,0 +1,133 @@
+#include <trace.hpp>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdio>
+
+std::atomic<bool> Tracer::enabled(false);
+
+// Per-thread ring of events. The owning thread appends; write_json() reads under the
+// same (uncontended in normal operation) mutex.
+struct ThreadBuffer {
+    std::mutex mutex;
+    std::vector<TraceEvent> events;     // Ring storage
+    size_t next = 0;                    // Slot written next
+    size_t count = 0;                   // Valid events (<= events.size())
+    uint64_t overwritten = 0;           // Events lost to wrap-around
+    int thread_id = 0;                  // Sequential id shown as "tid"
+    std::string thread_name;
+};
+
+// Buffers live until exit so events of finished threads can still be dumped
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    size_t capacity = Tracer::DEFAULT_CAPACITY;
+    std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+static TraceRegistry& registry() {
+    static TraceRegistry instance;
+    return instance;
+}
+
+static ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        TraceRegistry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = reg.buffers.back().get();
+        buffer->events.resize(reg.capacity);
+        buffer->thread_id = static_cast<int>(reg.buffers.size());
+    }
+    return *buffer;
+}
+
+// Names are string literals from this code base, but keep the JSON valid regardless
+static void write_escaped(std::ostream& out, const char* text) {
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') out << '\\';
+        if (static_cast<unsigned char>(*c) >= 0x20) out << *c;
+    }
+}
+
+void Tracer::set_buffer_capacity(size_t events) {
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.capacity = events > 0 ? events : 1;
+}
+
+void Tracer::set_thread_name(const char* name) {
+    ThreadBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.thread_name = name;
+}
+
+void Tracer::record(const char* name, const char* category, uint64_t start_ns, uint64_t duration_ns) {
+    ThreadBuffer& buffer = thread_buffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.events[buffer.next] = TraceEvent{name, category, start_ns, duration_ns};
+    buffer.next = (buffer.next + 1) % buffer.events.size();
+    if (buffer.count < buffer.events.size()) buffer.count++;
+    else buffer.overwritten++;
+}
+
+uint64_t Tracer::now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - registry().epoch).count());
+}
+
+bool Tracer::write_json(const std::string& filename) {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Tracer: Failed to open output file - " << filename << std::endl;
+        return false;
+    }
+
+    TraceRegistry& reg = registry();
+    std::lock_guard<std::mutex> registry_lock(reg.mutex);
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    size_t written = 0;
+    uint64_t overwritten = 0;
+    char number[64];
+    for (const auto& buffer : reg.buffers) {
+        std::lock_guard<std::mutex> lock(buffer->mutex);
+        overwritten += buffer->overwritten;
+
+        if (!buffer->thread_name.empty()) {
+            file << (first ? "" : ",\n") << "{\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id
+                 << ",\"name\":\"thread_name\",\"args\":{\"name\":\"";
+            write_escaped(file, buffer->thread_name.c_str());
+            file << "\"}}";
+            first = false;
+        }
+
+        // Oldest event first: the ring starts at 'next' once it has wrapped
+        size_t start = buffer->count < buffer->events.size() ? 0 : buffer->next;
+        for (size_t k = 0; k < buffer->count; ++k) {
+            const TraceEvent& e = buffer->events[(start + k) % buffer->events.size()];
+            file << (first ? "" : ",\n") << "{\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"name\":\"";
+            write_escaped(file, e.name);
+            file << "\",\"cat\":\"";
+            write_escaped(file, e.category);
+            // Chrome trace timestamps are microseconds
+            std::snprintf(number, sizeof(number), "\",\"ts\":%.3f,\"dur\":%.3f}", e.start_ns / 1e3, e.duration_ns / 1e3);
+            file << number;
+            first = false;
+            written++;
+        }
+    }
+    file << "\n]}\n";
+
+    std::cout << "[DEBUG] Tracer: Wrote " << written << " events to " << filename;
+    if (overwritten > 0) std::cout << " (" << overwritten << " older events overwritten)";
+    std::cout << std::endl;
+    return static_cast<bool>(file);
+}
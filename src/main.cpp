@@ -21,8 +21,18 @@
 // LICENSE: Apache-2.0
 
 #include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
 #include <fluid.hpp>
 #include <render.hpp>
+#include <snapshot.hpp>
+#include <triple_buffer.hpp>
+#include <frame_sink.hpp>
+#include <trace.hpp>
+#include <checkpoint.hpp>
 
 int main() {
     std::cout << "[DEBUG] Main: Starting 2D BLW Fluid Simulation" << std::endl;
@@ -33,38 +43,143 @@ int main() {
     const float CELL_SIZE = 4.0f;  // Size of each cell (pixels)
     const float VISCOSITY = 0.01f; // Fluid viscosity (lower = more turbulent)
     const float GRAVITY = -0.001f; // Gravitational acceleration (negative = downward)
+    const CellOrdering CELL_ORDERING = CellOrdering::RowMajor; // Cell memory layout (RowMajor, Tiled, Morton)
+    const int TREE_ARITY = 4;      // Spatial tree arity (2, 4, 8, 16 or TREE_ARITY_AUTO to benchmark)
+    const PopulationPrecision POPULATION_PRECISION = PopulationPrecision::FP32; // Population storage (FP32, FP16, BF16)
+    const int SOLVER_THREADS = 1;  // Threads sharing update() (0 = all hardware threads, the renderer needs one too)
     const int WINDOW_WIDTH = GRID_WIDTH * CELL_SIZE;  // Window width (pixels)
     const int WINDOW_HEIGHT = GRID_HEIGHT * CELL_SIZE;// Window height (pixels)
+    const double PREVIEW_HZ = 30.0; // Snapshot publish / preview rate (the solver itself is not capped)
+    const Palette COLOR_PALETTE = Palette::BlueGreenRed; // Density color ramp (BlueGreenRed, Grayscale, Viridis, CoolWarm)
+    const float DENSITY_RANGE_MIN = 0.8f; // Density mapped to the start of the ramp
+    const float DENSITY_RANGE_MAX = 1.2f; // Density mapped to the end of the ramp
+    const int FRAME_EXPORT_EVERY = 0; // Export a density frame to "output/" every N steps (0 = off)
+    const double PROFILE_REPORT_SECONDS = 10.0; // Per-phase timing / MLUPS report interval (0 = off)
+    const bool TRACE_ENABLED = false; // Record phase/thread timelines and write "trace.json" on exit
+    const int CHECKPOINT_EVERY = 0;   // Write "checkpoint.blw" every N steps in the background (0 = off)
+    const bool RESUME_FROM_CHECKPOINT = false; // Start from "checkpoint.blw" instead of loading obstacles
     
     try {
+        Tracer::set_enabled(TRACE_ENABLED);
+        Tracer::set_thread_name("render");
+        
         // Initialize fluid simulation
         std::cout << "[DEBUG] Main: Initializing fluid simulation..." << std::endl;
-        BLWFluid fluid(GRID_WIDTH, GRID_HEIGHT, CELL_SIZE, VISCOSITY, GRAVITY);
+        BLWFluid fluid(GRID_WIDTH, GRID_HEIGHT, CELL_SIZE, VISCOSITY, GRAVITY, CELL_ORDERING, TREE_ARITY,
+                       POPULATION_PRECISION);
+        fluid.set_thread_count(SOLVER_THREADS);
+        
+        if (RESUME_FROM_CHECKPOINT) {
+            // Restores populations, obstacles and parameters (grid size must match)
+            if (!fluid.restore_checkpoint("checkpoint.blw")) {
+                return EXIT_FAILURE;
+            }
+        } else {
+            // Load obstacles (place these files in "obstacles/" folder)
+            std::cout << "[DEBUG] Main: Loading obstacles..." << std::endl;
+            fluid.add_obstacle_from_file("obstacles/obstacle1.txt");
+            fluid.add_obstacle_from_file("obstacles/obstacle2.txt");
+            fluid.add_obstacle_from_file("obstacles/obstacle3.txt");
+        }
         
-        // Load obstacles (place these files in "obstacles/" folder)
-        std::cout << "[DEBUG] Main: Loading obstacles..." << std::endl;
-        fluid.add_obstacle_from_file("obstacles/obstacle1.txt");
-        fluid.add_obstacle_from_file("obstacles/obstacle2.txt");
-        fluid.add_obstacle_from_file("obstacles/obstacle3.txt");
+        // Snapshots flow solver -> renderer through a lock-free triple buffer
+        TripleBuffer<FieldSnapshot> snapshots;
+        fluid.fill_snapshot(snapshots.write_buffer());
+        snapshots.publish();
         
         // Initialize renderer
         std::cout << "[DEBUG] Main: Initializing renderer..." << std::endl;
-        Render render(fluid, WINDOW_WIDTH, WINDOW_HEIGHT, "2D BLW Fluid Simulation (N-ary Tree)");
+        Render render(fluid, snapshots, WINDOW_WIDTH, WINDOW_HEIGHT, "2D BLW Fluid Simulation (N-ary Tree)");
+        render.set_colormap(COLOR_PALETTE, DENSITY_RANGE_MIN, DENSITY_RANGE_MAX);
+        
+        // Optional frame export (encoded on the sink's writer thread, never stalls the solver)
+        std::unique_ptr<FrameSink> frame_sink;
+        if (FRAME_EXPORT_EVERY > 0) {
+            FrameSinkConfig export_config;
+            export_config.palette = COLOR_PALETTE;
+            export_config.range_min = DENSITY_RANGE_MIN;
+            export_config.range_max = DENSITY_RANGE_MAX;
+            frame_sink = std::make_unique<FrameSink>(export_config);
+        }
+        
+        // Optional background checkpoints (captured between steps on the solver thread)
+        std::unique_ptr<CheckpointWriter> checkpoints;
+        if (CHECKPOINT_EVERY > 0) {
+            checkpoints = std::make_unique<CheckpointWriter>();
+        }
         
-        // Main simulation loop
+        // Phase timers: solver phases are recorded by BLWFluid, frames by Render
+        PhaseProfiler& profiler = fluid.get_profiler();
+        profiler.set_enabled(PROFILE_REPORT_SECONDS > 0.0);
+        profiler.restart_window();
+        
+        // Simulation thread: runs update() at full speed and publishes a snapshot at PREVIEW_HZ
+        std::atomic<bool> sim_running(true);
+        std::exception_ptr sim_error;
+        std::thread sim_thread([&]() {
+            Tracer::set_thread_name("solver");
+            try {
+                using clock = std::chrono::steady_clock;
+                const auto publish_interval = std::chrono::duration_cast<clock::duration>(
+                    std::chrono::duration<double>(1.0 / PREVIEW_HZ));
+                auto next_publish = clock::now();
+                FieldSnapshot export_snapshot;
+                long next_export = fluid.get_step_count() + FRAME_EXPORT_EVERY;
+                long next_checkpoint = fluid.get_step_count() + CHECKPOINT_EVERY;
+                
+                while (sim_running.load(std::memory_order_relaxed)) {
+                    fluid.update();          // Update fluid simulation
+                    
+                    auto now = clock::now();
+                    if (now >= next_publish) {
+                        fluid.fill_snapshot(snapshots.write_buffer());
+                        snapshots.publish();
+                        next_publish = now + publish_interval;
+                    }
+                    
+                    if (frame_sink && fluid.get_step_count() >= next_export) {
+                        fluid.fill_snapshot(export_snapshot);
+                        frame_sink->submit(export_snapshot); // Dropped if the writer falls behind
+                        next_export += FRAME_EXPORT_EVERY;
+                    }
+                    
+                    if (checkpoints && fluid.get_step_count() >= next_checkpoint) {
+                        checkpoints->submit(fluid, "checkpoint.blw"); // Skipped if the previous one is still writing
+                        next_checkpoint += CHECKPOINT_EVERY;
+                    }
+                    
+                    if (fluid.get_step_count() % 1000 == 0) {
+                        std::cout << "[DEBUG] Main: Step " << fluid.get_step_count() << " - Simulation running..." << std::endl;
+                    }
+                    
+                    if (PROFILE_REPORT_SECONDS > 0.0 && profiler.window_seconds() >= PROFILE_REPORT_SECONDS) {
+                        profiler.report(std::cout);
+                    }
+                }
+            } catch (...) {
+                sim_error = std::current_exception();
+                sim_running = false;
+            }
+        });
+        
+        // Render loop (main thread owns the GLFW context)
         std::cout << "[DEBUG] Main: Starting main loop (ESC to quit)" << std::endl;
-        int frame = 0;
-        while (render.is_running()) {
+        while (render.is_running() && sim_running.load(std::memory_order_relaxed)) {
             render.process_input();  // Handle ESC key
-            fluid.update();          // Update fluid simulation
-            render.render();         // Render fluid + obstacles + UI
+            render.render();         // Render latest snapshot + UI
             render.swap_buffers();   // Swap double buffers
-            render.poll_events();    // Poll input events
-            
-            if (frame % 100 == 0) {
-                std::cout << "[DEBUG] Main: Frame " << frame << " - Simulation running..." << std::endl;
-            }
-            frame++;
+            render.wait_events(1.0 / PREVIEW_HZ); // Poll input events, pacing the preview
+        }
+        
+        sim_running = false;
+        sim_thread.join();
+        if (sim_error) {
+            std::rethrow_exception(sim_error);
+        }
+        
+        if (TRACE_ENABLED) {
+            frame_sink.reset(); // Finish pending writes so their spans are in the trace
+            Tracer::write_json("trace.json");
         }
         
         std::cout << "[DEBUG] Main: Simulation exited successfully" << std::endl;
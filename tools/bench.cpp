@@ -0,0 +1,679 @@
+// -*- coding: utf-8 -*-
+// Copyright 2025(C) CryptoChat Dinnerb0ne<tomma_2022@outlook.com>
+//
+//    Copyright 2025 [Dinnberb0ne]
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// description: Microbenchmarks for the solver kernels, spatial tree, obstacles and color conversion
+// LICENSE: Apache-2.0
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <random>
+#include <memory>
+#include <fluid.hpp>
+#include <ensemble.hpp>
+#include <colormap.hpp>
+#include <snapshot.hpp>
+
+// One measured figure. Results are matched against a baseline by "name/params".
+struct BenchResult {
+    std::string name;                 // e.g. "kernel.update"
+    std::string params;               // e.g. "grid=256x256"
+    double value;
+    std::string unit;                 // e.g. "MLUPS"
+    bool higher_is_better;
+};
+
+struct BenchConfig {
+    std::vector<int> grid_sizes = {64, 128, 256, 512}; // Square grids for kernel benchmarks
+    int repeat = 5;                   // Repetitions per benchmark (best one is reported)
+    int steps = 5;                    // update() calls per kernel repetition
+    std::string format = "text";      // text | json | csv
+    std::string output;               // Result file (empty = stdout)
+    std::string compare;              // Baseline file (json or csv from a previous run)
+    double threshold = 5.0;           // Regression threshold in percent
+    std::string filter;               // Only run benchmarks whose name contains this
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --sizes LIST         Comma-separated square grid sizes (default 64,128,256,512)\n"
+              << "  --repeat N           Repetitions per benchmark, best is reported (default 5)\n"
+              << "  --steps N            update() calls per kernel repetition (default 5)\n"
+              << "  --format NAME        text | json | csv (default text)\n"
+              << "  --output FILE        Write results to FILE instead of stdout\n"
+              << "  --compare FILE       Compare against a baseline written with --format json or csv\n"
+              << "  --threshold PCT      Slowdown (percent) flagged as a regression (default 5)\n"
+              << "  --filter TEXT        Only run benchmarks whose name contains TEXT\n"
+              << "  --quick              Small sizes and 3 repetitions (smoke test)\n";
+}
+
+static bool parse_args(int argc, char** argv, BenchConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return false;
+        }
+        if (arg == "--quick") {
+            cfg.grid_sizes = {64, 128};
+            cfg.repeat = 3;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "[ERROR] Bench: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--repeat") cfg.repeat = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--steps") cfg.steps = std::max(1, std::atoi(value.c_str()));
+        else if (arg == "--output") cfg.output = value;
+        else if (arg == "--compare") cfg.compare = value;
+        else if (arg == "--threshold") cfg.threshold = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--filter") cfg.filter = value;
+        else if (arg == "--format") {
+            if (value != "text" && value != "json" && value != "csv") {
+                std::cerr << "[ERROR] Bench: Unknown format - " << value << std::endl;
+                return false;
+            }
+            cfg.format = value;
+        } else if (arg == "--sizes") {
+            cfg.grid_sizes.clear();
+            std::istringstream list(value);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                int size = std::atoi(item.c_str());
+                if (size > 0) cfg.grid_sizes.push_back(size);
+            }
+            if (cfg.grid_sizes.empty()) {
+                std::cerr << "[ERROR] Bench: No valid grid size in - " << value << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "[ERROR] Bench: Unknown option - " << arg << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+using bench_clock = std::chrono::steady_clock;
+
+static double seconds_since(bench_clock::time_point start) {
+    return std::chrono::duration<double>(bench_clock::now() - start).count();
+}
+
+// Regular polygon approximating a circle (closed by ObstacleManager)
+static std::vector<Vec2> circle_polygon(Vec2 center, float radius, int vertices) {
+    std::vector<Vec2> polygon;
+    for (int i = 0; i < vertices; ++i) {
+        float angle = 6.2831853f * i / vertices;
+        polygon.emplace_back(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle));
+    }
+    return polygon;
+}
+
+static std::string grid_param(int size) {
+    return "grid=" + std::to_string(size) + "x" + std::to_string(size);
+}
+
+// update() and its phases. A fresh solver per repetition keeps the measured steps
+// before the unforced field develops extreme values.
+static void bench_kernels(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    const float CELL_SIZE = 4.0f;
+    const ProfilePhase phases[] = {ProfilePhase::Collision, ProfilePhase::Streaming,
+                                   ProfilePhase::Boundary, ProfilePhase::Density};
+
+    for (int size : cfg.grid_sizes) {
+        std::cerr << "[INFO] Bench: kernels " << size << "x" << size << std::endl;
+        double best_update = 0.0;
+        double best_phase[PhaseProfiler::PHASE_COUNT] = {};
+
+        for (int r = 0; r < cfg.repeat; ++r) {
+            BLWFluid fluid(size, size, CELL_SIZE, 0.01f, -0.001f);
+            fluid.add_obstacle_from_vertices(circle_polygon(Vec2(size * CELL_SIZE * 0.5f, size * CELL_SIZE * 0.5f),
+                                                            size * CELL_SIZE * 0.15f, 32));
+            PhaseProfiler& profiler = fluid.get_profiler();
+            profiler.set_enabled(true);
+            profiler.collect_window(); // Drop construction time
+
+            auto start = bench_clock::now();
+            for (int s = 0; s < cfg.steps; ++s) fluid.update();
+            double seconds = seconds_since(start);
+            PhaseProfiler::Window window = profiler.collect_window();
+
+            double updates = static_cast<double>(size) * size * cfg.steps;
+            best_update = std::max(best_update, updates / seconds / 1e6);
+            for (ProfilePhase phase : phases) {
+                int p = static_cast<int>(phase);
+                if (window.ns[p] > 0) best_phase[p] = std::max(best_phase[p], updates / (window.ns[p] * 1e-9) / 1e6);
+            }
+        }
+
+        results.push_back({"kernel.update", grid_param(size), best_update, "MLUPS", true});
+        for (ProfilePhase phase : phases) {
+            results.push_back({std::string("kernel.") + PhaseProfiler::phase_name(phase), grid_param(size),
+                               best_phase[static_cast<int>(phase)], "MLUPS", true});
+        }
+    }
+}
+
+// Solver with the circular test obstacle used by the precision benchmarks
+template <typename Scalar>
+static std::unique_ptr<BasicBLWFluid<Scalar>> make_precision_fluid(int size, PopulationPrecision precision) {
+    const float CELL_SIZE = 4.0f;
+    auto fluid = std::make_unique<BasicBLWFluid<Scalar>>(size, size, CELL_SIZE, Scalar(0.01), Scalar(-0.001),
+                                                         CellOrdering::RowMajor, 4, precision);
+    fluid->add_obstacle_from_vertices(circle_polygon(Vec2(size * CELL_SIZE * 0.5f, size * CELL_SIZE * 0.5f),
+                                                     size * CELL_SIZE * 0.15f, 32));
+    fluid->get_profiler().set_enabled(false);
+    return fluid;
+}
+
+// Relative L2 norm of the population difference between two solvers on the same grid
+template <typename Fluid, typename Reference>
+static double population_error(const Fluid& fluid, const Reference& reference, int cells) {
+    double error = 0.0, norm = 0.0;
+    for (int idx = 0; idx < cells; ++idx) {
+        for (int i = 0; i < NUM_VELOCITIES; ++i) {
+            double ref = reference.get_population(idx, i);
+            double diff = fluid.get_population(idx, i) - ref;
+            error += diff * diff;
+            norm += ref * ref;
+        }
+    }
+    return norm > 0.0 ? std::sqrt(error / norm) : 0.0;
+}
+
+// update() throughput of one scalar type / population format, and its error against
+// 'reference' (the full-precision solver the format would replace)
+template <typename Scalar, typename Reference>
+static void bench_precision_case(const BenchConfig& cfg, int size, PopulationPrecision precision,
+                                 const Reference* reference, int error_steps, std::vector<BenchResult>& results) {
+    double best = 0.0;
+    for (int r = 0; r < cfg.repeat; ++r) {
+        auto fluid = make_precision_fluid<Scalar>(size, precision);
+        auto start = bench_clock::now();
+        for (int s = 0; s < cfg.steps; ++s) fluid->update();
+        best = std::max(best, static_cast<double>(size) * size * cfg.steps / seconds_since(start) / 1e6);
+    }
+    std::string params = std::string("scalar=") + (sizeof(Scalar) == sizeof(double) ? "double" : "float") +
+                         ",precision=" + precision_name(precision) + "," + grid_param(size);
+    results.push_back({"precision.update", params, best, "MLUPS", true});
+    if (!reference) return; // The reference itself
+
+    auto fluid = make_precision_fluid<Scalar>(size, precision);
+    for (int s = 0; s < error_steps; ++s) fluid->update();
+    results.push_back({"precision.error", params, population_error(*fluid, *reference, size * size), "rel.L2", false});
+}
+
+// Throughput cost and accuracy of double arithmetic and of the reduced population formats
+static void bench_precision(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    // The unforced field grows quickly after a few steps (FP16 overflows at 65504), so the
+    // error is taken while values are still in the range the solver normally runs in
+    const int ERROR_STEPS = 3;
+
+    for (int size : cfg.grid_sizes) {
+        std::cerr << "[INFO] Bench: precision " << size << "x" << size << std::endl;
+        // 16-bit formats are measured against the float/FP32 solver they replace, float
+        // arithmetic and FP32 storage of doubles against the double/FP64 solver
+        auto float_reference = make_precision_fluid<float>(size, PopulationPrecision::FP32);
+        auto double_reference = make_precision_fluid<double>(size, PopulationPrecision::FP64);
+        for (int s = 0; s < ERROR_STEPS; ++s) {
+            float_reference->update();
+            double_reference->update();
+        }
+
+        bench_precision_case<float>(cfg, size, PopulationPrecision::FP32, double_reference.get(), ERROR_STEPS, results);
+        for (PopulationPrecision precision : {PopulationPrecision::FP16, PopulationPrecision::BF16}) {
+            bench_precision_case<float>(cfg, size, precision, float_reference.get(), ERROR_STEPS, results);
+        }
+        bench_precision_case<double, BLWFluidDouble>(cfg, size, PopulationPrecision::FP64, nullptr, ERROR_STEPS, results);
+        bench_precision_case<double>(cfg, size, PopulationPrecision::FP32, double_reference.get(), ERROR_STEPS, results);
+    }
+}
+
+// Largest relative L2 error against the FP32 solver accepted from each 16-bit format, at any
+// step of the accuracy check (a few times the error of a correct round-to-nearest-even codec)
+struct AccuracyTolerance {
+    PopulationPrecision precision;
+    double max_error;
+};
+static const AccuracyTolerance ACCURACY_TOLERANCES[] = {
+    {PopulationPrecision::FP16, 5e-3},
+    {PopulationPrecision::BF16, 3e-2},
+};
+
+// Run FP16 and BF16 solvers step by step next to the float/FP32 solver and compare all
+// populations after every step. The unforced test field grows with every step, so the check
+// stops once the FP32 populations leave the range FP16 resolves (|f| > 2048, where its spacing
+// reaches 2); fewer than ACCURACY_MIN_STEPS steps in range also fails. Returns the number of
+// failed checks.
+static int check_accuracy(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    const int ACCURACY_STEPS = 100;
+    const int ACCURACY_MIN_STEPS = 4;
+    const double FP16_RESOLVED_RANGE = 2048.0;
+
+    int failures = 0;
+    for (int size : cfg.grid_sizes) {
+        std::cerr << "[INFO] Bench: accuracy " << size << "x" << size << std::endl;
+        const int cells = size * size;
+        for (const AccuracyTolerance& tolerance : ACCURACY_TOLERANCES) {
+            auto reference = make_precision_fluid<float>(size, PopulationPrecision::FP32);
+            auto fluid = make_precision_fluid<float>(size, tolerance.precision);
+            double max_error = 0.0;
+            int steps = 0;
+            while (steps < ACCURACY_STEPS) {
+                reference->update();
+                double largest = 0.0;
+                for (int idx = 0; idx < cells; ++idx) {
+                    for (int i = 0; i < NUM_VELOCITIES; ++i) {
+                        largest = std::max(largest, std::fabs(static_cast<double>(reference->get_population(idx, i))));
+                    }
+                }
+                if (!(largest <= FP16_RESOLVED_RANGE)) break; // Also stops on inf / NaN
+                fluid->update();
+                steps++;
+                max_error = std::max(max_error, population_error(*fluid, *reference, cells));
+            }
+
+            const std::string params = std::string("precision=") + precision_name(tolerance.precision) + "," +
+                                       grid_param(size);
+            results.push_back({"accuracy.error", params, max_error, "rel.L2", false});
+            results.push_back({"accuracy.steps", params, static_cast<double>(steps), "steps", true});
+            if (steps < ACCURACY_MIN_STEPS) {
+                std::cerr << "[ERROR] Bench: Accuracy check " << params << " compared only " << steps
+                          << " steps (reference out of range)" << std::endl;
+                failures++;
+            } else if (!(max_error <= tolerance.max_error)) {
+                std::cerr << "[ERROR] Bench: Accuracy check " << params << " error " << max_error
+                          << " exceeds " << tolerance.max_error << " within " << steps << " steps" << std::endl;
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+// SpatialIndex build and 3x3-cell range queries for every supported arity
+static void bench_tree(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    const int size = cfg.grid_sizes.back();
+    const float CELL_SIZE = 4.0f;
+    std::cerr << "[INFO] Bench: tree " << size << "x" << size << std::endl;
+
+    std::vector<Vec2> positions;
+    positions.reserve(static_cast<size_t>(size) * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            positions.emplace_back(x * CELL_SIZE, y * CELL_SIZE);
+        }
+    }
+    std::vector<std::pair<Vec2, Vec2>> queries;
+    for (int y = 1; y < size - 1; y += 3) {
+        for (int x = 1; x < size - 1; x += 3) {
+            queries.emplace_back(Vec2((x - 1) * CELL_SIZE, (y - 1) * CELL_SIZE),
+                                 Vec2((x + 1) * CELL_SIZE, (y + 1) * CELL_SIZE));
+        }
+    }
+
+    Vec2 world_min(0.0f, 0.0f);
+    Vec2 world_max(size * CELL_SIZE, size * CELL_SIZE);
+    for (int arity : SUPPORTED_TREE_ARITIES) {
+        double best_build = 0.0, best_query = 0.0;
+        size_t checksum = 0;
+        for (int r = 0; r < cfg.repeat; ++r) {
+            auto tree = make_spatial_index(arity, world_min, world_max, CELL_SIZE * 2.0f);
+            auto start = bench_clock::now();
+            tree->build(positions);
+            best_build = std::max(best_build, positions.size() / seconds_since(start) / 1e6);
+
+            start = bench_clock::now();
+            for (const auto& q : queries) checksum += tree->query_range(q.first, q.second).size();
+            best_query = std::max(best_query, queries.size() / seconds_since(start) / 1e6);
+        }
+        if (checksum == 0) std::cerr << "[WARNING] Bench: Tree queries returned no cells" << std::endl;
+
+        std::string params = "arity=" + std::to_string(arity) + "," + grid_param(size);
+        results.push_back({"tree.build", params, best_build, "Mpoints/s", true});
+        results.push_back({"tree.query", params, best_query, "Mqueries/s", true});
+    }
+}
+
+// Point-in-polygon tests and rasterizing a polygon into the cell mask
+static void bench_obstacles(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    std::cerr << "[INFO] Bench: obstacles" << std::endl;
+    const int POINTS = 1 << 20;
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<float> coord(0.0f, 200.0f);
+    std::vector<Vec2> points(POINTS);
+    for (auto& p : points) p = Vec2(coord(rng), coord(rng));
+
+    for (int vertices : {8, 64, 512}) {
+        PolygonObstacle polygon;
+        polygon.vertices = circle_polygon(Vec2(100.0f, 100.0f), 80.0f, vertices);
+        polygon.vertices.push_back(polygon.vertices.front());
+
+        double best = 0.0;
+        size_t inside = 0;
+        for (int r = 0; r < cfg.repeat; ++r) {
+            auto start = bench_clock::now();
+            for (const auto& p : points) inside += polygon.point_inside(p) ? 1 : 0;
+            best = std::max(best, POINTS / seconds_since(start) / 1e6);
+        }
+        if (inside == 0) std::cerr << "[WARNING] Bench: No point inside the test polygon" << std::endl;
+        results.push_back({"obstacle.point_inside", "vertices=" + std::to_string(vertices), best, "Mpoints/s", true});
+    }
+
+    const int size = cfg.grid_sizes.back();
+    const float CELL_SIZE = 4.0f;
+    double best = 0.0;
+    for (int r = 0; r < cfg.repeat; ++r) {
+        BLWFluid fluid(size, size, CELL_SIZE, 0.01f, -0.001f);
+        auto polygon = circle_polygon(Vec2(size * CELL_SIZE * 0.5f, size * CELL_SIZE * 0.5f), size * CELL_SIZE * 0.3f, 64);
+        auto start = bench_clock::now();
+        fluid.add_obstacle_from_vertices(polygon); // Re-voxelizes the whole grid
+        best = std::max(best, static_cast<double>(size) * size / seconds_since(start) / 1e6);
+    }
+    results.push_back({"obstacle.voxelize", "vertices=64," + grid_param(size), best, "Mcells/s", true});
+}
+
+// Snapshot copy and density → RGBA conversion (the per-frame render/export work)
+static void bench_render_buffers(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    const int size = cfg.grid_sizes.back();
+    std::cerr << "[INFO] Bench: render buffers " << size << "x" << size << std::endl;
+
+    BLWFluid fluid(size, size, 4.0f, 0.01f, -0.001f);
+    fluid.update();
+    FieldSnapshot snapshot;
+    fluid.fill_snapshot(snapshot); // Warm buffers
+
+    // Same grid without the kernel's velocity planes: the snapshot recomputes velocity
+    BLWFluid recompute(size, size, 4.0f, 0.01f, -0.001f);
+    recompute.set_field_output_enabled(false);
+    recompute.update();
+    FieldSnapshot recompute_snapshot;
+    recompute.fill_snapshot(recompute_snapshot);
+
+    const double cells = static_cast<double>(size) * size;
+    double best_snapshot = 0.0, best_recompute = 0.0, best_colormap = 0.0;
+    Colormap colormap;
+    std::vector<uint32_t> rgba(snapshot.density.size());
+    for (int r = 0; r < cfg.repeat; ++r) {
+        auto start = bench_clock::now();
+        fluid.fill_snapshot(snapshot);
+        best_snapshot = std::max(best_snapshot, cells / seconds_since(start) / 1e6);
+
+        start = bench_clock::now();
+        recompute.fill_snapshot(recompute_snapshot);
+        best_recompute = std::max(best_recompute, cells / seconds_since(start) / 1e6);
+
+        start = bench_clock::now();
+        colormap.map_field(snapshot.density.data(), snapshot.obstacle.words(), rgba.size(), rgba.data());
+        best_colormap = std::max(best_colormap, cells / seconds_since(start) / 1e6);
+    }
+    results.push_back({"render.snapshot", grid_param(size), best_snapshot, "Mcells/s", true});
+    results.push_back({"render.snapshot", "fields=off," + grid_param(size), best_recompute, "Mcells/s", true});
+    results.push_back({"render.colormap", grid_param(size), best_colormap, "Mcells/s", true});
+}
+
+// K small simulations with different viscosity/gravity: interleaved in one EnsembleFluid
+// against K separate solvers stepped one after another (same total lattice updates)
+static void bench_ensemble(const BenchConfig& cfg, std::vector<BenchResult>& results) {
+    const int GRID = 128;          // Typical parameter-sweep grid
+    const float CELL_SIZE = 4.0f;
+    const auto obstacle = circle_polygon(Vec2(GRID * CELL_SIZE * 0.5f, GRID * CELL_SIZE * 0.5f),
+                                         GRID * CELL_SIZE * 0.15f, 32);
+
+    for (int instances : {16, 64}) {
+        std::cerr << "[INFO] Bench: ensemble " << instances << " x " << GRID << "x" << GRID << std::endl;
+        std::vector<float> viscosities, gravities;
+        for (int k = 0; k < instances; ++k) {
+            viscosities.push_back(0.005f + 0.0005f * k);
+            gravities.push_back(-0.001f * (k % 4));
+        }
+        const double updates = static_cast<double>(GRID) * GRID * instances * cfg.steps;
+
+        double best_ensemble = 0.0, best_separate = 0.0;
+        for (int r = 0; r < cfg.repeat; ++r) {
+            EnsembleFluid ensemble(GRID, GRID, CELL_SIZE, viscosities, gravities);
+            ensemble.add_obstacle_from_vertices(obstacle);
+            auto start = bench_clock::now();
+            for (int s = 0; s < cfg.steps; ++s) ensemble.update();
+            best_ensemble = std::max(best_ensemble, updates / seconds_since(start) / 1e6);
+
+            std::vector<std::unique_ptr<BLWFluid>> separate;
+            for (int k = 0; k < instances; ++k) {
+                separate.push_back(std::make_unique<BLWFluid>(GRID, GRID, CELL_SIZE, viscosities[k], gravities[k]));
+                separate.back()->add_obstacle_from_vertices(obstacle);
+                separate.back()->set_field_output_enabled(false);
+                separate.back()->get_profiler().set_enabled(false);
+            }
+            start = bench_clock::now();
+            for (int s = 0; s < cfg.steps; ++s) {
+                for (auto& fluid : separate) fluid->update();
+            }
+            best_separate = std::max(best_separate, updates / seconds_since(start) / 1e6);
+        }
+
+        std::string params = "instances=" + std::to_string(instances) + "," + grid_param(GRID);
+        results.push_back({"ensemble.update", params, best_ensemble, "MLUPS", true});
+        results.push_back({"ensemble.separate", params, best_separate, "MLUPS", true});
+    }
+}
+
+static void write_results(std::ostream& out, const std::string& format, const std::vector<BenchResult>& results) {
+    char line[256];
+    if (format == "json") {
+        // One result per line, so the file also diffs well in version control
+        out << "{\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& r = results[i];
+            std::snprintf(line, sizeof(line),
+                          "    {\"name\": \"%s\", \"params\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", \"higher_is_better\": %s}%s\n",
+                          r.name.c_str(), r.params.c_str(), r.value, r.unit.c_str(),
+                          r.higher_is_better ? "true" : "false", i + 1 < results.size() ? "," : "");
+            out << line;
+        }
+        out << "  ]\n}\n";
+    } else if (format == "csv") {
+        out << "name,params,value,unit,higher_is_better\n";
+        for (const auto& r : results) {
+            // params may contain commas
+            std::snprintf(line, sizeof(line), "%s,\"%s\",%.6g,%s,%d\n", r.name.c_str(), r.params.c_str(), r.value,
+                          r.unit.c_str(), r.higher_is_better ? 1 : 0);
+            out << line;
+        }
+    } else {
+        for (const auto& r : results) {
+            std::snprintf(line, sizeof(line), "%-24s %-40s %12.4g %s\n", r.name.c_str(), r.params.c_str(), r.value,
+                          r.unit.c_str());
+            out << line;
+        }
+    }
+}
+
+// Value of "key": "..." or "key": number on one JSON line ("" if absent)
+static std::string json_field(const std::string& line, const std::string& key) {
+    size_t pos = line.find("\"" + key + "\"");
+    if (pos == std::string::npos) return "";
+    pos = line.find(':', pos);
+    if (pos == std::string::npos) return "";
+    pos = line.find_first_not_of(" \t", pos + 1);
+    if (pos == std::string::npos) return "";
+    if (line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        return end == std::string::npos ? "" : line.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+}
+
+// Split one CSV line written by write_results (only params is quoted)
+static std::vector<std::string> csv_fields(const std::string& line) {
+    std::vector<std::string> fields;
+    std::string field;
+    bool quoted = false;
+    for (char c : line) {
+        if (c == '"') quoted = !quoted;
+        else if (c == ',' && !quoted) {
+            fields.push_back(field);
+            field.clear();
+        } else if (c != '\r') field += c;
+    }
+    fields.push_back(field);
+    return fields;
+}
+
+// Load a result file written by this tool (json or csv); returns false if unreadable
+static bool load_baseline(const std::string& filename, std::map<std::string, BenchResult>& baseline) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Bench: Failed to open baseline - " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        BenchResult r;
+        if (line.find("\"name\"") != std::string::npos) {
+            r.name = json_field(line, "name");
+            r.params = json_field(line, "params");
+            r.value = std::strtod(json_field(line, "value").c_str(), nullptr);
+            r.unit = json_field(line, "unit");
+            r.higher_is_better = json_field(line, "higher_is_better") != "false";
+        } else {
+            std::vector<std::string> fields = csv_fields(line);
+            if (fields.size() != 5 || fields[0] == "name") continue;
+            r.name = fields[0];
+            r.params = fields[1];
+            r.value = std::strtod(fields[2].c_str(), nullptr);
+            r.unit = fields[3];
+            r.higher_is_better = fields[4] != "0";
+        }
+        if (!r.name.empty()) baseline[r.name + "/" + r.params] = r;
+    }
+
+    if (baseline.empty()) {
+        std::cerr << "[ERROR] Bench: No results found in baseline - " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Print current vs baseline; returns the number of regressions beyond the threshold
+static int compare_results(std::ostream& out, const std::vector<BenchResult>& results,
+                           const std::map<std::string, BenchResult>& baseline, double threshold) {
+    int regressions = 0;
+    char line[256];
+    std::snprintf(line, sizeof(line), "\n%-24s %-40s %12s %12s %8s\n", "benchmark", "params", "baseline", "current", "change");
+    out << line;
+    for (const auto& r : results) {
+        auto it = baseline.find(r.name + "/" + r.params);
+        if (it == baseline.end() || it->second.value <= 0.0) {
+            std::snprintf(line, sizeof(line), "%-24s %-40s %12s %12.3f %8s\n", r.name.c_str(), r.params.c_str(), "-",
+                          r.value, "new");
+            out << line;
+            continue;
+        }
+
+        // Positive change = faster, whichever direction the unit improves in
+        double change = (r.value - it->second.value) / it->second.value * 100.0;
+        if (!r.higher_is_better) change = -change;
+        bool regressed = change < -threshold;
+        if (regressed) regressions++;
+        std::snprintf(line, sizeof(line), "%-24s %-40s %12.3f %12.3f %+7.1f%%%s\n", r.name.c_str(), r.params.c_str(),
+                      it->second.value, r.value, change, regressed ? "  REGRESSION" : "");
+        out << line;
+    }
+    return regressions;
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        return EXIT_FAILURE;
+    }
+
+    std::map<std::string, BenchResult> baseline;
+    if (!cfg.compare.empty() && !load_baseline(cfg.compare, baseline)) {
+        return EXIT_FAILURE;
+    }
+
+    std::vector<BenchResult> results;
+    int accuracy_failures = 0;
+    try {
+        // Silence the solver's [DEBUG] output so stdout carries only results
+        std::streambuf* console = std::cout.rdbuf(nullptr);
+        // A group runs if the filter matches its name ("tree") or one of its benchmarks ("tree.query")
+        auto wanted = [&cfg](const std::string& group) {
+            return cfg.filter.empty() || group.find(cfg.filter) != std::string::npos || cfg.filter.rfind(group, 0) == 0;
+        };
+        if (wanted("kernel")) bench_kernels(cfg, results);
+        if (wanted("precision")) bench_precision(cfg, results);
+        if (wanted("accuracy")) accuracy_failures = check_accuracy(cfg, results);
+        if (wanted("tree")) bench_tree(cfg, results);
+        if (wanted("obstacle")) bench_obstacles(cfg, results);
+        if (wanted("render")) bench_render_buffers(cfg, results);
+        if (wanted("ensemble")) bench_ensemble(cfg, results);
+        std::cout.rdbuf(console);
+        std::cout.clear();
+    } catch (const std::exception& e) {
+        std::cerr << "[FATAL] Bench: Exception - " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!cfg.filter.empty()) {
+        results.erase(std::remove_if(results.begin(), results.end(), [&cfg](const BenchResult& r) {
+            return r.name.find(cfg.filter) == std::string::npos;
+        }), results.end());
+    }
+
+    if (cfg.output.empty()) {
+        write_results(std::cout, cfg.format, results);
+    } else {
+        std::ofstream file(cfg.output);
+        if (!file.is_open()) {
+            std::cerr << "[ERROR] Bench: Failed to open output file - " << cfg.output << std::endl;
+            return EXIT_FAILURE;
+        }
+        write_results(file, cfg.format, results);
+        std::cerr << "[INFO] Bench: Wrote " << results.size() << " results to " << cfg.output << std::endl;
+    }
+
+    if (accuracy_failures > 0) {
+        std::cerr << "[ERROR] Bench: " << accuracy_failures << " accuracy check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!baseline.empty()) {
+        // Keep stdout machine-readable when it carries json/csv results
+        std::ostream& out = (cfg.output.empty() && cfg.format != "text") ? std::cerr : std::cout;
+        int regressions = compare_results(out, results, baseline, cfg.threshold);
+        if (regressions > 0) {
+            std::cerr << "[WARNING] Bench: " << regressions << " regression(s) beyond " << cfg.threshold << "%" << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
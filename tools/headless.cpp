@@ -0,0 +1,382 @@
+// -*- coding: utf-8 -*-
+// Copyright 2025(C) CryptoChat Dinnerb0ne<tomma_2022@outlook.com>
+//
+//    Copyright 2025 [Dinnberb0ne]
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// description: Headless BLW fluid runner (no GLFW/OpenGL) for batch jobs
+// LICENSE: Apache-2.0
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <fluid.hpp>
+#include <colormap.hpp>
+#include <snapshot.hpp>
+#include <frame_sink.hpp>
+#include <trace.hpp>
+#include <checkpoint.hpp>
+
+// Runner configuration (defaults match src/main.cpp)
+struct HeadlessConfig {
+    int grid_width = 128;
+    int grid_height = 128;
+    double cell_size = 4.0;
+    double viscosity = 0.01;
+    double gravity = -0.001;
+    size_t scalar_size = 0;           // 4 = float, 8 = double solver (0 = float, or the checkpoint's type on restart)
+    CellOrdering ordering = CellOrdering::RowMajor;
+    int tree_arity = 4;
+    PopulationPrecision precision = PopulationPrecision::FP32; // Population storage format
+    bool precision_given = false;     // Otherwise the native format of the solver (FP32 / FP64)
+    int threads = 0;                  // Solver threads (0 = all hardware threads)
+    ThreadPlacement placement = ThreadPlacement::Dynamic; // Chunk assignment / CPU binding of the solver threads
+    HugePageMode huge_pages = HugePageMode::Off; // Page backing of the lattice buffers
+    std::string diagnostics_file;     // Per-step mass / momentum / energy / drag CSV (empty = off)
+    bool field_output = false;        // Velocity planes written by the kernel (pays off with frequent frames)
+    int steps = 1000;                 // Number of update() calls
+    int output_every = 100;           // Export a frame every N steps (0 = never)
+    FrameSinkConfig output;           // Frame export settings (field, format, palette, range, queue)
+    std::vector<std::string> obstacle_files;
+    std::string obstacle_set_file;    // Mapped obstacle set used instead of obstacle_files (empty = none)
+    std::string save_obstacle_set_file; // Write the rasterized obstacles here for other runs (empty = no)
+    bool profile = false;             // Print the per-phase timing breakdown
+    std::string trace_file;           // Chrome trace output (empty = tracing off)
+    std::string checkpoint_file = "checkpoint.blw"; // Checkpoint written every checkpoint_every steps
+    int checkpoint_every = 0;         // Checkpoint interval in steps (0 = never)
+    std::string restart_file;         // Resume from this checkpoint (empty = fresh start)
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --width N            Grid cells in X (default 128)\n"
+              << "  --height N           Grid cells in Y (default 128)\n"
+              << "  --cell-size F        Cell size in world units (default 4.0)\n"
+              << "  --viscosity F        Kinematic viscosity (default 0.01)\n"
+              << "  --gravity F          Gravity in Y (default -0.001)\n"
+              << "  --ordering NAME      rowmajor | tiled | morton (default rowmajor)\n"
+              << "  --tree-arity N       2 | 4 | 8 | 16 | auto (default 4)\n"
+              << "  --scalar NAME        Solver arithmetic: float | double (default float)\n"
+              << "  --precision NAME     Population storage: fp64 | fp32 | fp16 | bf16 (default: as --scalar)\n"
+              << "  --threads N          Solver threads, 0 = all hardware threads (default 0)\n"
+              << "  --placement NAME     dynamic | static | pinned: static keeps each row band (and its memory)\n"
+              << "                       on one thread, pinned also binds the threads to CPUs (default dynamic)\n"
+              << "  --huge-pages NAME    Lattice page backing: off | thp | hugetlb (Linux only, default off)\n"
+              << "  --steps N            Simulation steps (default 1000)\n"
+              << "  --output-every N     Frame interval in steps, 0 disables (default 100)\n"
+              << "  --output-dir PATH    Frame directory (default output)\n"
+              << "  --field NAME         density | speed | vorticity (default density)\n"
+              << "  --format NAME        ppm | y4m | png (default ppm)\n"
+              << "  --queue N            Frames buffered for the writer thread (default 8)\n"
+              << "  --field-output       Write velocity planes in the kernel (faster frames, slower steps)\n"
+              << "  --block-output       Wait for the writer instead of dropping frames when the queue is full\n"
+              << "  --palette NAME       bgr | gray | viridis | coolwarm (default bgr)\n"
+              << "  --range-min F        Field value at the start of the color ramp (default 0.8)\n"
+              << "  --range-max F        Field value at the end of the color ramp (default 1.2)\n"
+              << "  --obstacle FILE      Obstacle polygon file (repeatable)\n"
+              << "  --obstacle-set FILE  Map a rasterized obstacle set (from --save-obstacle-set) instead of --obstacle\n"
+              << "  --save-obstacle-set FILE  Write the rasterized obstacles for other runs on the same grid\n"
+              << "  --profile            Print per-phase timings, MLUPS and bandwidth per interval\n"
+              << "  --diagnostics FILE   Write mass, momentum, kinetic energy and drag of every step as CSV\n"
+              << "  --trace FILE         Write a Chrome trace (chrome://tracing, ui.perfetto.dev) of all phases\n"
+              << "  --checkpoint FILE    Checkpoint file (default checkpoint.blw)\n"
+              << "  --checkpoint-every N Write a checkpoint every N steps in the background, 0 disables (default 0)\n"
+              << "  --restart FILE       Resume from a checkpoint (grid, cell size, viscosity, gravity and obstacles\n"
+              << "                       come from the file); --steps more steps are run\n";
+}
+
+// Parse command line; returns false on error or --help
+static bool parse_args(int argc, char** argv, HeadlessConfig& cfg) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return false;
+        }
+        if (arg == "--block-output") {
+            cfg.output.block_when_full = true;
+            continue;
+        }
+        if (arg == "--profile") {
+            cfg.profile = true;
+            continue;
+        }
+        if (arg == "--field-output") {
+            cfg.field_output = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "[ERROR] Headless: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--width") cfg.grid_width = std::atoi(value.c_str());
+        else if (arg == "--height") cfg.grid_height = std::atoi(value.c_str());
+        else if (arg == "--cell-size") cfg.cell_size = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--viscosity") cfg.viscosity = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--gravity") cfg.gravity = std::strtod(value.c_str(), nullptr);
+        else if (arg == "--steps") cfg.steps = std::atoi(value.c_str());
+        else if (arg == "--output-every") cfg.output_every = std::atoi(value.c_str());
+        else if (arg == "--output-dir") cfg.output.output_dir = value;
+        else if (arg == "--obstacle") cfg.obstacle_files.push_back(value);
+        else if (arg == "--obstacle-set") cfg.obstacle_set_file = value;
+        else if (arg == "--save-obstacle-set") cfg.save_obstacle_set_file = value;
+        else if (arg == "--trace") cfg.trace_file = value;
+        else if (arg == "--threads") cfg.threads = std::atoi(value.c_str());
+        else if (arg == "--diagnostics") cfg.diagnostics_file = value;
+        else if (arg == "--checkpoint") cfg.checkpoint_file = value;
+        else if (arg == "--checkpoint-every") cfg.checkpoint_every = std::atoi(value.c_str());
+        else if (arg == "--restart") cfg.restart_file = value;
+        else if (arg == "--range-min") cfg.output.range_min = std::strtof(value.c_str(), nullptr);
+        else if (arg == "--range-max") cfg.output.range_max = std::strtof(value.c_str(), nullptr);
+        else if (arg == "--queue") cfg.output.queue_capacity = static_cast<size_t>(std::atoi(value.c_str()));
+        else if (arg == "--palette") {
+            if (!Colormap::palette_from_name(value, cfg.output.palette)) {
+                std::cerr << "[ERROR] Headless: Unknown palette - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--field") {
+            if (!FrameSink::field_from_name(value, cfg.output.field)) {
+                std::cerr << "[ERROR] Headless: Unknown field - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--format") {
+            if (!FrameSink::format_from_name(value, cfg.output.format)) {
+                std::cerr << "[ERROR] Headless: Unknown format - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--placement") {
+            if (!placement_from_name(value, cfg.placement)) {
+                std::cerr << "[ERROR] Headless: Unknown placement - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--huge-pages") {
+            if (!huge_pages_from_name(value, cfg.huge_pages)) {
+                std::cerr << "[ERROR] Headless: Unknown huge page mode - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--tree-arity") cfg.tree_arity = (value == "auto") ? TREE_ARITY_AUTO : std::atoi(value.c_str());
+        else if (arg == "--precision") {
+            if (!precision_from_name(value, cfg.precision)) {
+                std::cerr << "[ERROR] Headless: Unknown precision - " << value << std::endl;
+                return false;
+            }
+            cfg.precision_given = true;
+        }
+        else if (arg == "--scalar") {
+            if (value == "float") cfg.scalar_size = sizeof(float);
+            else if (value == "double") cfg.scalar_size = sizeof(double);
+            else {
+                std::cerr << "[ERROR] Headless: Unknown scalar type - " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--ordering") {
+            if (value == "rowmajor") cfg.ordering = CellOrdering::RowMajor;
+            else if (value == "tiled") cfg.ordering = CellOrdering::Tiled;
+            else if (value == "morton") cfg.ordering = CellOrdering::Morton;
+            else {
+                std::cerr << "[ERROR] Headless: Unknown ordering - " << value << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << "[ERROR] Headless: Unknown option - " << arg << std::endl;
+            return false;
+        }
+    }
+    if (cfg.grid_width <= 0 || cfg.grid_height <= 0 || cfg.steps < 0) {
+        std::cerr << "[ERROR] Headless: Grid size and step count must be positive" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Run the configured simulation with a float or double solver
+template <typename Scalar>
+static int run_simulation(const HeadlessConfig& cfg) {
+    std::cout << "[DEBUG] Headless: Initializing " << cfg.grid_width << "x" << cfg.grid_height
+              << (sizeof(Scalar) == sizeof(double) ? " double" : " float") << " simulation for " << cfg.steps
+              << " steps" << std::endl;
+    BasicBLWFluid<Scalar> fluid(cfg.grid_width, cfg.grid_height, static_cast<Scalar>(cfg.cell_size),
+                                static_cast<Scalar>(cfg.viscosity), static_cast<Scalar>(cfg.gravity), cfg.ordering,
+                                cfg.tree_arity, cfg.precision_given ? cfg.precision : native_precision<Scalar>());
+    fluid.set_field_output_enabled(cfg.field_output);
+    fluid.set_thread_count(cfg.threads, cfg.placement);
+    if (cfg.huge_pages != HugePageMode::Off) {
+        fluid.set_huge_pages(cfg.huge_pages);
+    }
+    std::cout << "[DEBUG] Headless: Solver uses " << fluid.get_thread_count() << " "
+              << placement_name(cfg.placement) << " threads" << std::endl;
+
+    if (!cfg.restart_file.empty()) {
+        if (!fluid.restore_checkpoint(cfg.restart_file)) {
+            return EXIT_FAILURE;
+        }
+        if (!cfg.obstacle_files.empty() || !cfg.obstacle_set_file.empty()) {
+            std::cerr << "[WARNING] Headless: Ignoring --obstacle, obstacles come from the checkpoint" << std::endl;
+        }
+    } else if (!cfg.obstacle_set_file.empty()) {
+        // Read-only mapping: concurrent runs on the same file share its pages
+        if (!fluid.set_obstacles(ObstacleSet::load(cfg.obstacle_set_file))) {
+            return EXIT_FAILURE;
+        }
+    } else {
+        for (const auto& file : cfg.obstacle_files) {
+            if (!fluid.add_obstacle_from_file(file)) {
+                std::cerr << "[WARNING] Headless: Skipping obstacle - " << file << std::endl;
+            }
+        }
+    }
+
+    if (!cfg.save_obstacle_set_file.empty()) {
+        if (!fluid.get_obstacle_set()->save(cfg.save_obstacle_set_file)) {
+            return EXIT_FAILURE;
+        }
+        std::printf("[INFO] Headless: Obstacle set written to %s\n", cfg.save_obstacle_set_file.c_str());
+    }
+
+    // Diagnostics are summed inside update(); writing them is one line per step
+    FILE* diagnostics = nullptr;
+    if (!cfg.diagnostics_file.empty()) {
+        diagnostics = std::fopen(cfg.diagnostics_file.c_str(), "w");
+        if (!diagnostics) {
+            std::cerr << "[ERROR] Headless: Cannot open diagnostics file - " << cfg.diagnostics_file << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::fprintf(diagnostics, "step,mass,momentum_x,momentum_y,kinetic_energy,drag_x,drag_y\n");
+        fluid.set_diagnostics_enabled(true);
+    }
+
+    // Checkpoints are captured between steps and written on the writer's own thread
+    std::unique_ptr<CheckpointWriter> checkpoints;
+    if (cfg.checkpoint_every > 0) {
+        checkpoints = std::make_unique<CheckpointWriter>();
+    }
+
+    // Frames are encoded and written on the sink's own thread
+    std::unique_ptr<FrameSink> sink;
+    if (cfg.output_every > 0) {
+        sink = std::make_unique<FrameSink>(cfg.output);
+    }
+    FieldSnapshot snapshot;
+    PhaseProfiler& profiler = fluid.get_profiler();
+    profiler.set_enabled(cfg.profile);
+    profiler.restart_window();
+
+    using clock = std::chrono::steady_clock;
+    const double cells_per_step = static_cast<double>(cfg.grid_width) * cfg.grid_height;
+    auto start = clock::now();
+    auto interval_start = start;
+    int interval_steps = 0;
+
+    for (int i = 0; i < cfg.steps; ++i) {
+        fluid.update();
+        interval_steps++;
+        const long step = fluid.get_step_count(); // Continues from the checkpoint on restart
+
+        if (diagnostics) {
+            const FlowDiagnostics& d = fluid.get_diagnostics();
+            std::fprintf(diagnostics, "%ld,%.17g,%.17g,%.17g,%.17g,%.17g,%.17g\n", d.step, d.mass,
+                         d.momentum_x, d.momentum_y, d.kinetic_energy, d.drag_x, d.drag_y);
+        }
+
+        if (checkpoints && step % cfg.checkpoint_every == 0) {
+            checkpoints->submit(fluid, cfg.checkpoint_file);
+        }
+
+        if (cfg.output_every > 0 && step % cfg.output_every == 0) {
+            auto now = clock::now();
+            double seconds = std::chrono::duration<double>(now - interval_start).count();
+            std::printf("[INFO] Headless: Step %ld - %.1f steps/s, %.2f MLUPS\n", step,
+                        interval_steps / seconds, interval_steps * cells_per_step / seconds / 1e6);
+            if (cfg.profile) profiler.report(std::cout);
+
+            fluid.fill_snapshot(snapshot);
+            sink->submit(snapshot);
+
+            // Exclude snapshot time from the next interval's throughput
+            interval_start = clock::now();
+            interval_steps = 0;
+            profiler.restart_window();
+        }
+    }
+
+    double total = std::chrono::duration<double>(clock::now() - start).count();
+    if (cfg.steps > 0 && total > 0.0) std::printf("[INFO] Headless: %d steps in %.3f s - %.1f steps/s, %.2f MLUPS (including snapshots)\n",
+                cfg.steps, total, cfg.steps / total, cfg.steps * cells_per_step / total / 1e6);
+    if (cfg.profile && interval_steps > 0) profiler.report(std::cout); // Steps after the last interval
+    if (diagnostics) {
+        std::fclose(diagnostics);
+        std::printf("[INFO] Headless: Diagnostics written to %s\n", cfg.diagnostics_file.c_str());
+    }
+    if (checkpoints) {
+        checkpoints->flush();
+        std::printf("[INFO] Headless: %zu checkpoints written to %s\n",
+                    checkpoints->get_checkpoints_written(), cfg.checkpoint_file.c_str());
+    }
+    if (sink) {
+        sink->flush();
+        std::printf("[INFO] Headless: %zu frames written, %zu dropped\n",
+                    sink->get_frames_written(), sink->get_frames_dropped());
+    }
+    if (!cfg.trace_file.empty()) {
+        sink.reset(); // Writer thread done, its spans are complete
+        Tracer::write_json(cfg.trace_file);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv) {
+    HeadlessConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Tracer::set_enabled(!cfg.trace_file.empty());
+        Tracer::set_thread_name("solver");
+
+        // A restart takes the grid and physical parameters from the checkpoint header
+        if (!cfg.restart_file.empty()) {
+            CheckpointHeader header;
+            if (!read_checkpoint_header(cfg.restart_file, header)) {
+                return EXIT_FAILURE;
+            }
+            cfg.grid_width = header.width;
+            cfg.grid_height = header.height;
+            cfg.cell_size = header.cell_size;
+            cfg.viscosity = header.viscosity;
+            cfg.gravity = header.gravity;
+            if (cfg.scalar_size == 0) cfg.scalar_size = header.scalar_size;
+        }
+
+        if (cfg.scalar_size == sizeof(double)) {
+            return run_simulation<double>(cfg);
+        }
+        return run_simulation<float>(cfg);
+
+    } catch (const std::exception& e) {
+        std::cerr << "[FATAL] Headless: Exception - " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
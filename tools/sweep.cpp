@@ -0,0 +1,630 @@
+// -*- coding: utf-8 -*-
+// Copyright 2025(C) CryptoChat Dinnerb0ne<tomma_2022@outlook.com>
+//
+//    Copyright 2025 [Dinnberb0ne]
+//
+//    Licensed under the Apache License, Version 2.0 (the "License");
+//    you may not use this file except in compliance with the License.
+//    You may obtain a copy of the License at
+//
+//       http://www.apache.org/licenses/LICENSE-2.0
+//
+//    Unless required by applicable law or agreed to in writing, software
+//    distributed under the License is distributed on an "AS IS" BASIS,
+//    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//    See the License for the specific language governing permissions and
+//    limitations under the License.
+//
+// description: Parameter sweep scheduler - runs many BLW fluid configurations across all cores
+// LICENSE: Apache-2.0
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <set>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <thread>
+#include <fluid.hpp>
+#include <ensemble.hpp>
+#include <snapshot.hpp>
+
+// One simulation of the sweep
+struct SweepJob {
+    int grid_width = 128;
+    int grid_height = 128;
+    double cell_size = 4.0;
+    double viscosity = 0.01;
+    double gravity = -0.001;
+    int steps = 1000;
+    size_t scalar_size = sizeof(float); // 4 = float, 8 = double solver
+    CellOrdering ordering = CellOrdering::RowMajor;
+    PopulationPrecision precision = PopulationPrecision::FP32;
+    bool precision_given = false;     // Otherwise the native format of the solver (FP32 / FP64)
+    std::string obstacles;            // Obstacle files joined by '+' (empty = none)
+
+    size_t cell_count() const { return static_cast<size_t>(grid_width) * grid_height; }
+};
+
+// Scheduler settings and the expanded job list
+struct SweepConfig {
+    int threads = 0;                  // Threads for the whole sweep (0 = all hardware threads)
+    int batch_size = 16;              // Most instances per ensemble batch (1 = no batching)
+    size_t batch_cells = 128 * 128;   // Grids up to this many cells are batched
+    size_t team_cells = 256 * 256;    // Larger jobs get one thread per this many cells
+    std::string output = "sweep_results.csv"; // Result summary
+    bool dry_run = false;             // Print the schedule without running it
+    std::vector<SweepJob> jobs;
+};
+
+// Outcome of one job
+struct SweepResult {
+    bool ok = false;                  // Ran to the end (the fields may still have diverged)
+    size_t unit = 0;                  // Unit (batch or single run) the job ran in
+    int instances = 1;                // Jobs in that unit
+    int threads = 1;                  // Threads the unit used
+    double seconds = 0.0;             // Wall time of the unit
+    double mass = 0.0;                // Sum of density over fluid cells after the last step
+    double kinetic_energy = 0.0;      // Sum of rho |u|^2 / 2 over fluid cells
+    double max_speed = 0.0;           // Largest |u| (NaN when any cell's velocity is NaN)
+
+    // Ran to the end, but with non-finite fields
+    bool diverged() const {
+        return ok && !(std::isfinite(mass) && std::isfinite(kinetic_energy) && std::isfinite(max_speed));
+    }
+};
+
+// Jobs that run together: several small jobs in one ensemble, or one job with a team of threads
+struct SweepUnit {
+    std::vector<size_t> jobs;         // Indices into SweepConfig::jobs
+    int threads = 1;                  // Solver threads (the scheduler reserves them all)
+    double cost = 0.0;                // Estimated work: cells * steps * instances
+};
+
+static void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " SPEC [options]\n"
+              << "  --threads N          Threads for the whole sweep, 0 = all hardware threads (default: spec or 0)\n"
+              << "  --output FILE        Result CSV (default: spec or sweep_results.csv)\n"
+              << "  --batch N            Most jobs per ensemble batch, 1 disables batching (default: spec or 16)\n"
+              << "  --dry-run            Print the schedule without running it\n"
+              << "\n"
+              << "SPEC lines ('#' starts a comment):\n"
+              << "  threads N | batch N | batch-cells N | team-cells N | output FILE\n"
+              << "  job key=value[,value...] ...  (every combination of the listed values is one job)\n"
+              << "  keys: width height cell-size viscosity gravity steps scalar (float|double)\n"
+              << "        precision (fp64|fp32|fp16|bf16) ordering (rowmajor|tiled|morton)\n"
+              << "        obstacles (files joined by '+', or none)\n";
+}
+
+// Number in a grouping key, printed with every digit needed to read it back exactly
+static std::string key_number(double value) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.17g", value);
+    return text;
+}
+
+static std::vector<std::string> split(const std::string& text, char separator) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, separator)) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+// Apply one key=value to a job; false for unknown keys or values
+static bool set_job_value(SweepJob& job, const std::string& key, const std::string& value) {
+    if (key == "width") job.grid_width = std::atoi(value.c_str());
+    else if (key == "height") job.grid_height = std::atoi(value.c_str());
+    else if (key == "cell-size") job.cell_size = std::strtod(value.c_str(), nullptr);
+    else if (key == "viscosity") job.viscosity = std::strtod(value.c_str(), nullptr);
+    else if (key == "gravity") job.gravity = std::strtod(value.c_str(), nullptr);
+    else if (key == "steps") job.steps = std::atoi(value.c_str());
+    else if (key == "obstacles") job.obstacles = (value == "none") ? "" : value;
+    else if (key == "scalar") {
+        if (value == "float") job.scalar_size = sizeof(float);
+        else if (value == "double") job.scalar_size = sizeof(double);
+        else return false;
+    }
+    else if (key == "precision") {
+        if (!precision_from_name(value, job.precision)) return false;
+        job.precision_given = true;
+    }
+    else if (key == "ordering") {
+        if (value == "rowmajor") job.ordering = CellOrdering::RowMajor;
+        else if (value == "tiled") job.ordering = CellOrdering::Tiled;
+        else if (value == "morton") job.ordering = CellOrdering::Morton;
+        else return false;
+    }
+    else return false;
+    return true;
+}
+
+// Expand "job key=a,b key=c,d" into one job per combination (last key varies fastest)
+static bool expand_job_line(const std::vector<std::string>& tokens, int line_number, std::vector<SweepJob>& jobs) {
+    std::vector<SweepJob> expanded(1);
+    for (size_t t = 1; t < tokens.size(); ++t) {
+        const size_t eq = tokens[t].find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "[ERROR] Sweep: Line " << line_number << ": expected key=value - " << tokens[t] << std::endl;
+            return false;
+        }
+        const std::string key = tokens[t].substr(0, eq);
+        const std::vector<std::string> values = split(tokens[t].substr(eq + 1), ',');
+        if (values.empty()) {
+            std::cerr << "[ERROR] Sweep: Line " << line_number << ": no value for " << key << std::endl;
+            return false;
+        }
+        std::vector<SweepJob> next;
+        next.reserve(expanded.size() * values.size());
+        for (const SweepJob& base : expanded) {
+            for (const std::string& value : values) {
+                SweepJob job = base;
+                if (!set_job_value(job, key, value)) {
+                    std::cerr << "[ERROR] Sweep: Line " << line_number << ": invalid " << key << " - " << value << std::endl;
+                    return false;
+                }
+                next.push_back(job);
+            }
+        }
+        expanded = std::move(next);
+    }
+    for (const SweepJob& job : expanded) {
+        if (job.grid_width <= 0 || job.grid_height <= 0 || job.steps < 0 || job.cell_size <= 0.0) {
+            std::cerr << "[ERROR] Sweep: Line " << line_number << ": grid size, cell size and steps must be positive"
+                      << std::endl;
+            return false;
+        }
+    }
+    jobs.insert(jobs.end(), expanded.begin(), expanded.end());
+    return true;
+}
+
+static bool load_spec(const std::string& filename, SweepConfig& cfg) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "[ERROR] Sweep: Cannot open spec - " << filename << std::endl;
+        return false;
+    }
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        const size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream stream(line);
+        std::vector<std::string> tokens;
+        std::string token;
+        while (stream >> token) tokens.push_back(token);
+        if (tokens.empty()) continue;
+
+        const std::string& key = tokens[0];
+        if (key == "job") {
+            if (!expand_job_line(tokens, line_number, cfg.jobs)) return false;
+            continue;
+        }
+        if (tokens.size() != 2) {
+            std::cerr << "[ERROR] Sweep: Line " << line_number << ": expected '" << key << " VALUE'" << std::endl;
+            return false;
+        }
+        const std::string& value = tokens[1];
+        if (key == "threads") cfg.threads = std::atoi(value.c_str());
+        else if (key == "batch") cfg.batch_size = std::max(1, std::atoi(value.c_str()));
+        else if (key == "batch-cells") cfg.batch_cells = static_cast<size_t>(std::atoll(value.c_str()));
+        else if (key == "team-cells") cfg.team_cells = std::max<size_t>(1, std::atoll(value.c_str()));
+        else if (key == "output") cfg.output = value;
+        else {
+            std::cerr << "[ERROR] Sweep: Line " << line_number << ": unknown setting - " << key << std::endl;
+            return false;
+        }
+    }
+    if (cfg.jobs.empty()) {
+        std::cerr << "[ERROR] Sweep: No jobs in " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Parse command line (spec first, options override it); returns false on error or --help
+static bool parse_args(int argc, char** argv, SweepConfig& cfg) {
+    if (argc < 2 || std::string(argv[1]) == "--help" || std::string(argv[1]) == "-h") {
+        print_usage(argv[0]);
+        return false;
+    }
+    if (!load_spec(argv[1], cfg)) return false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--dry-run") {
+            cfg.dry_run = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "[ERROR] Sweep: Missing value for " << arg << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") cfg.threads = std::atoi(value.c_str());
+        else if (arg == "--output") cfg.output = value;
+        else if (arg == "--batch") cfg.batch_size = std::max(1, std::atoi(value.c_str()));
+        else {
+            std::cerr << "[ERROR] Sweep: Unknown option - " << arg << std::endl;
+            return false;
+        }
+    }
+    if (cfg.threads <= 0) cfg.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    return true;
+}
+
+// Read-only obstacle data shared by all jobs: every list of obstacle files is loaded once,
+// and every (files, grid, cell size, ordering) is rasterized once, by whichever job needs it
+// first. All solvers on that lattice then hold the same ObstacleSet.
+class ObstacleLibrary {
+private:
+    std::map<std::string, std::shared_ptr<const ObstacleManager>> geometry; // Obstacle files -> polygons
+    std::map<std::string, std::shared_future<SharedObstacleSet>> sets; // Set key -> rasterized set
+    std::mutex mutex;                 // Guards 'sets'
+
+    static std::string set_key(const SweepJob& job) {
+        return job.obstacles + "|" + std::to_string(job.grid_width) + "x" + std::to_string(job.grid_height) + "|" +
+               key_number(job.cell_size) + "|" + std::to_string(static_cast<int>(job.ordering));
+    }
+
+public:
+    // Load every obstacle set used by 'jobs' (call before the workers start)
+    void load(const std::vector<SweepJob>& jobs) {
+        for (const SweepJob& job : jobs) {
+            if (geometry.count(job.obstacles)) continue;
+            auto manager = std::make_shared<ObstacleManager>();
+            for (const std::string& file : split(job.obstacles, '+')) {
+                if (!manager->add_obstacle_from_file(file)) {
+                    std::cerr << "[WARNING] Sweep: Skipping obstacle - " << file << std::endl;
+                }
+            }
+            geometry[job.obstacles] = manager;
+        }
+    }
+
+    // Obstacle set for the job's lattice; the first caller rasterizes, the others wait for it
+    SharedObstacleSet get_set(const SweepJob& job) {
+        std::promise<SharedObstacleSet> promise;
+        std::shared_future<SharedObstacleSet> future;
+        bool owner = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = sets.find(set_key(job));
+            if (it == sets.end()) {
+                future = promise.get_future().share();
+                sets.emplace(set_key(job), future);
+                owner = true;
+            } else {
+                future = it->second;
+            }
+        }
+        if (owner) {
+            LatticeLayout layout(job.grid_width, job.grid_height, job.ordering, CX, CY, NUM_VELOCITIES);
+            promise.set_value(std::make_shared<const ObstacleSet>(*geometry.at(job.obstacles), layout,
+                                                                  static_cast<float>(job.cell_size)));
+        }
+        return future.get();
+    }
+
+    size_t get_set_count() const { return sets.size(); }
+};
+
+// Group jobs into units. Small jobs that differ only in viscosity and gravity share one
+// ensemble (up to batch_size instances); large jobs get one thread per team_cells cells.
+static std::vector<SweepUnit> plan_units(const SweepConfig& cfg) {
+    std::vector<SweepUnit> units;
+    std::map<std::string, std::vector<size_t>> batches; // Batch key -> jobs, in spec order
+    std::vector<std::string> batch_order;
+    for (size_t j = 0; j < cfg.jobs.size(); ++j) {
+        const SweepJob& job = cfg.jobs[j];
+        const bool native = !job.precision_given ||
+            job.precision == (job.scalar_size == sizeof(double) ? PopulationPrecision::FP64 : PopulationPrecision::FP32);
+        if (cfg.batch_size > 1 && native && job.cell_count() <= cfg.batch_cells) {
+            std::ostringstream key;
+            key << job.grid_width << "x" << job.grid_height << "|" << key_number(job.cell_size) << "|" << job.steps << "|"
+                << job.scalar_size << "|" << static_cast<int>(job.ordering) << "|" << job.obstacles;
+            if (!batches.count(key.str())) batch_order.push_back(key.str());
+            batches[key.str()].push_back(j);
+            continue;
+        }
+        SweepUnit unit;
+        unit.jobs.push_back(j);
+        unit.threads = static_cast<int>(std::clamp<size_t>((job.cell_count() + cfg.team_cells - 1) / cfg.team_cells,
+                                                           1, static_cast<size_t>(cfg.threads)));
+        unit.cost = static_cast<double>(job.cell_count()) * job.steps;
+        units.push_back(unit);
+    }
+    for (const std::string& key : batch_order) {
+        const std::vector<size_t>& members = batches[key];
+        for (size_t first = 0; first < members.size(); first += cfg.batch_size) {
+            SweepUnit unit;
+            unit.jobs.assign(members.begin() + first,
+                             members.begin() + std::min(members.size(), first + cfg.batch_size));
+            const SweepJob& job = cfg.jobs[unit.jobs[0]];
+            unit.cost = static_cast<double>(job.cell_count()) * job.steps * unit.jobs.size();
+            units.push_back(unit);
+        }
+    }
+    return units;
+}
+
+// Mass, kinetic energy and peak speed of the final fields (same order for batched and single runs)
+static void summarize(const FieldSnapshot& snapshot, SweepResult& result) {
+    for (size_t i = 0; i < snapshot.density.size(); ++i) {
+        if (snapshot.obstacle.test(i)) continue;
+        const double rho = snapshot.density[i];
+        const double u_sq = static_cast<double>(snapshot.velocity_x[i]) * snapshot.velocity_x[i] +
+                            static_cast<double>(snapshot.velocity_y[i]) * snapshot.velocity_y[i];
+        result.mass += rho;
+        result.kinetic_energy += 0.5 * rho * u_sq;
+        // Snapshots give a cell with NaN density zero velocity, so its speed is NaN here too.
+        // std::max would drop NaN and report a diverged job as at rest; keep the first NaN instead.
+        const double speed = std::isnan(rho) ? rho : std::sqrt(u_sq);
+        if (!std::isnan(result.max_speed) && !(speed <= result.max_speed)) result.max_speed = speed;
+    }
+}
+
+template <typename Scalar>
+static void run_single(const SweepJob& job, int threads, ObstacleLibrary& library, SweepResult& result) {
+    BasicBLWFluid<Scalar> fluid(job.grid_width, job.grid_height, static_cast<Scalar>(job.cell_size),
+                                static_cast<Scalar>(job.viscosity), static_cast<Scalar>(job.gravity), job.ordering, 4,
+                                job.precision_given ? job.precision : native_precision<Scalar>());
+    fluid.set_thread_count(threads);
+    fluid.set_field_output_enabled(false); // Only the final fields are read
+    if (!fluid.set_obstacles(library.get_set(job))) return;
+    for (int s = 0; s < job.steps; ++s) fluid.update();
+
+    FieldSnapshot snapshot;
+    fluid.fill_snapshot(snapshot);
+    summarize(snapshot, result);
+    result.ok = true;
+}
+
+template <typename Scalar>
+static void run_batch(const std::vector<SweepJob>& jobs, const SweepUnit& unit, ObstacleLibrary& library,
+                      std::vector<SweepResult>& results) {
+    const SweepJob& first = jobs[unit.jobs[0]];
+    std::vector<Scalar> viscosities, gravities;
+    for (size_t j : unit.jobs) {
+        viscosities.push_back(static_cast<Scalar>(jobs[j].viscosity));
+        gravities.push_back(static_cast<Scalar>(jobs[j].gravity));
+    }
+    BasicEnsembleFluid<Scalar> ensemble(first.grid_width, first.grid_height, static_cast<Scalar>(first.cell_size),
+                                        viscosities, gravities, first.ordering);
+    ensemble.set_thread_count(unit.threads);
+    if (!ensemble.set_obstacles(library.get_set(first))) return;
+    for (int s = 0; s < first.steps; ++s) ensemble.update();
+
+    FieldSnapshot snapshot;
+    for (size_t k = 0; k < unit.jobs.size(); ++k) {
+        ensemble.fill_snapshot(static_cast<int>(k), snapshot);
+        summarize(snapshot, results[unit.jobs[k]]);
+        results[unit.jobs[k]].ok = true;
+    }
+}
+
+// Runs units on a fixed set of workers. Units are dealt round-robin, largest first, to
+// per-worker queues; a worker takes from the front of its own queue and, once it is empty,
+// steals from the back of the others. Every unit reserves its thread count from a shared
+// budget of cfg.threads, in FIFO order, so thread teams never oversubscribe the machine and
+// a waiting team is not starved by a stream of small units.
+class SweepScheduler {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<size_t> units;
+    };
+
+    const SweepConfig& cfg;
+    const std::vector<SweepUnit>& units;
+    ObstacleLibrary& library;
+    std::vector<SweepResult>& results;
+    std::vector<std::unique_ptr<WorkerQueue>> queues; // One per worker
+    std::mutex budget_mutex;          // Guards the fields below
+    std::condition_variable budget_changed;
+    int free_threads;                 // Threads not reserved by a running unit
+    unsigned long next_ticket = 0;    // FIFO order of reservations
+    unsigned long serving = 0;        // Ticket allowed to reserve next
+    size_t steals = 0;                // Units run by a worker other than their first owner
+
+    bool take_unit(size_t worker, size_t& unit) {
+        {
+            WorkerQueue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.units.empty()) {
+                unit = own.units.front();
+                own.units.pop_front();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues.size(); ++offset) {
+            WorkerQueue& victim = *queues[(worker + offset) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.units.empty()) {
+                unit = victim.units.back();
+                victim.units.pop_back();
+                std::lock_guard<std::mutex> budget_lock(budget_mutex);
+                steals++;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void reserve(int threads) {
+        std::unique_lock<std::mutex> lock(budget_mutex);
+        const unsigned long ticket = next_ticket++;
+        budget_changed.wait(lock, [&] { return ticket == serving && free_threads >= threads; });
+        free_threads -= threads;
+        serving++;
+        budget_changed.notify_all();
+    }
+
+    void release(int threads) {
+        std::lock_guard<std::mutex> lock(budget_mutex);
+        free_threads += threads;
+        budget_changed.notify_all();
+    }
+
+    void run_unit(size_t index) {
+        const SweepUnit& unit = units[index];
+        const SweepJob& first = cfg.jobs[unit.jobs[0]];
+        auto start = std::chrono::steady_clock::now();
+        try {
+            if (unit.jobs.size() > 1) {
+                if (first.scalar_size == sizeof(double)) run_batch<double>(cfg.jobs, unit, library, results);
+                else run_batch<float>(cfg.jobs, unit, library, results);
+            } else {
+                if (first.scalar_size == sizeof(double)) run_single<double>(first, unit.threads, library, results[unit.jobs[0]]);
+                else run_single<float>(first, unit.threads, library, results[unit.jobs[0]]);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[ERROR] Sweep: Unit " << index << " failed - " << e.what() << std::endl;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (size_t j : unit.jobs) {
+            results[j].unit = index;
+            results[j].instances = static_cast<int>(unit.jobs.size());
+            results[j].threads = unit.threads;
+            results[j].seconds = seconds;
+        }
+    }
+
+    void worker_loop(size_t worker) {
+        size_t unit;
+        while (take_unit(worker, unit)) {
+            reserve(units[unit].threads);
+            run_unit(unit);
+            release(units[unit].threads);
+        }
+    }
+
+public:
+    SweepScheduler(const SweepConfig& cfg, const std::vector<SweepUnit>& units, ObstacleLibrary& library,
+                   std::vector<SweepResult>& results)
+        : cfg(cfg), units(units), library(library), results(results), free_threads(cfg.threads) {
+        const size_t workers = std::min(static_cast<size_t>(cfg.threads), std::max<size_t>(units.size(), 1));
+        for (size_t w = 0; w < workers; ++w) queues.push_back(std::make_unique<WorkerQueue>());
+
+        std::vector<size_t> order(units.size());
+        for (size_t u = 0; u < order.size(); ++u) order[u] = u;
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return units[a].cost > units[b].cost; });
+        for (size_t n = 0; n < order.size(); ++n) queues[n % workers]->units.push_back(order[n]);
+    }
+
+    // Run every unit and wait for them
+    void run() {
+        std::vector<std::thread> workers;
+        for (size_t w = 1; w < queues.size(); ++w) workers.emplace_back(&SweepScheduler::worker_loop, this, w);
+        worker_loop(0);
+        for (auto& worker : workers) worker.join();
+    }
+
+    size_t get_steal_count() const { return steals; }
+};
+
+static const char* ordering_name(CellOrdering ordering) {
+    switch (ordering) {
+        case CellOrdering::Tiled: return "tiled";
+        case CellOrdering::Morton: return "morton";
+        default: return "rowmajor";
+    }
+}
+
+static bool write_results(const std::string& filename, const SweepConfig& cfg, const std::vector<SweepResult>& results) {
+    FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file) {
+        std::cerr << "[ERROR] Sweep: Cannot open result file - " << filename << std::endl;
+        return false;
+    }
+    std::fprintf(file, "job,width,height,cell_size,viscosity,gravity,steps,scalar,precision,ordering,obstacles,"
+                       "status,unit,instances,threads,seconds,mass,kinetic_energy,max_speed\n");
+    for (size_t j = 0; j < cfg.jobs.size(); ++j) {
+        const SweepJob& job = cfg.jobs[j];
+        const SweepResult& r = results[j];
+        const PopulationPrecision precision = job.precision_given ? job.precision
+            : (job.scalar_size == sizeof(double) ? PopulationPrecision::FP64 : PopulationPrecision::FP32);
+        std::fprintf(file, "%zu,%d,%d,%.9g,%.9g,%.9g,%d,%s,%s,%s,%s,%s,%zu,%d,%d,%.6f,%.17g,%.17g,%.17g\n", j,
+                     job.grid_width, job.grid_height, job.cell_size, job.viscosity, job.gravity, job.steps,
+                     job.scalar_size == sizeof(double) ? "double" : "float", precision_name(precision),
+                     ordering_name(job.ordering), job.obstacles.empty() ? "none" : job.obstacles.c_str(),
+                     !r.ok ? "failed" : (r.diverged() ? "diverged" : "ok"), r.unit, r.instances, r.threads, r.seconds, r.mass, r.kinetic_energy,
+                     r.max_speed);
+    }
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    SweepConfig cfg;
+    if (!parse_args(argc, argv, cfg)) {
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const std::vector<SweepUnit> units = plan_units(cfg);
+        size_t batched = 0, teams = 0;
+        for (const SweepUnit& unit : units) {
+            if (unit.jobs.size() > 1) batched += unit.jobs.size();
+            if (unit.threads > 1) teams++;
+        }
+        std::printf("[INFO] Sweep: %zu jobs in %zu units (%zu jobs batched, %zu thread teams) on %d threads\n",
+                    cfg.jobs.size(), units.size(), batched, teams, cfg.threads);
+        if (cfg.dry_run) {
+            for (size_t u = 0; u < units.size(); ++u) {
+                const SweepJob& job = cfg.jobs[units[u].jobs[0]];
+                std::printf("  unit %zu: %zu jobs, %dx%d, %d steps, %d threads\n", u, units[u].jobs.size(),
+                            job.grid_width, job.grid_height, job.steps, units[u].threads);
+            }
+            return EXIT_SUCCESS;
+        }
+
+        ObstacleLibrary library;
+        library.load(cfg.jobs);
+        std::vector<SweepResult> results(cfg.jobs.size());
+
+        auto start = std::chrono::steady_clock::now();
+        SweepScheduler scheduler(cfg, units, library, results);
+        scheduler.run();
+        const double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // Busy = thread-seconds reserved by units / thread-seconds available
+        double updates = 0.0, busy = 0.0;
+        size_t failed = 0, diverged = 0;
+        std::set<size_t> counted;
+        for (size_t j = 0; j < cfg.jobs.size(); ++j) {
+            if (!results[j].ok) failed++;
+            else if (results[j].diverged()) diverged++;
+            updates += static_cast<double>(cfg.jobs[j].cell_count()) * cfg.jobs[j].steps;
+            if (counted.insert(results[j].unit).second) busy += results[j].seconds * results[j].threads;
+        }
+        std::printf("[INFO] Sweep: %zu jobs done (%zu failed, %zu diverged) in %.3f s - %.2f MLUPS aggregate, "
+                    "%.0f%% of thread time busy\n", cfg.jobs.size() - failed, failed, diverged, total, updates / total / 1e6,
+                    total > 0.0 ? 100.0 * busy / (total * cfg.threads) : 0.0);
+        std::printf("[INFO] Sweep: %zu obstacle sets rasterized, %zu units stolen\n", library.get_set_count(),
+                    scheduler.get_steal_count());
+        if (!write_results(cfg.output, cfg, results)) {
+            return EXIT_FAILURE;
+        }
+        std::printf("[INFO] Sweep: Results written to %s\n", cfg.output.c_str());
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    } catch (const std::exception& e) {
+        std::cerr << "[FATAL] Sweep: Exception - " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}